@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Lock-free health counters for the audio callback.
+
+  ==============================================================================
+*/
+
+#include "AudioTelemetry.h"
+
+//==============================================================================
+void AudioTelemetry::prepare (double newSampleRate) noexcept
+{
+    sampleRate.store (newSampleRate, std::memory_order_relaxed);
+
+    // The gap before the first block after a restart isn't a late callback
+    previousStartTicks = 0;
+    previousBudgetTicks = 0;
+}
+
+juce::int64 AudioTelemetry::blockStarted() noexcept
+{
+    const auto now = juce::Time::getHighResolutionTicks();
+
+    if (previousStartTicks != 0 && (now - previousStartTicks) * 2 > previousBudgetTicks * 3)
+        increment (lateCallbacks);
+
+    previousStartTicks = now;
+    return now;
+}
+
+void AudioTelemetry::blockFinished (juce::int64 startTicks, int numSamples,
+                                    int numActiveVoices, int numVoiceSteals) noexcept
+{
+    const auto elapsed = juce::Time::getHighResolutionTicks() - startTicks;
+    const auto rate = sampleRate.load (std::memory_order_relaxed);
+    const auto budget = rate > 0.0 ? (juce::int64) ((double) numSamples / rate * ticksPerSecond) : 0;
+    const auto load = budget > 0 ? (double) elapsed / (double) budget : 0.0;
+
+    previousBudgetTicks = budget;
+
+    increment (numBlocks);
+    blockSize.store (numSamples, std::memory_order_relaxed);
+    lastBlockTicks.store (elapsed, std::memory_order_relaxed);
+    lastBudgetTicks.store (budget, std::memory_order_relaxed);
+    totalBlockTicks.store (totalBlockTicks.load (std::memory_order_relaxed) + (juce::uint64) elapsed, std::memory_order_relaxed);
+    totalBudgetTicks.store (totalBudgetTicks.load (std::memory_order_relaxed) + (juce::uint64) budget, std::memory_order_relaxed);
+    storeMax (peakBlockTicks, elapsed);
+    storeMax (peakLoad, (float) load);
+
+    if (load > 1.0)
+        increment (overruns);
+
+    auto bucket = juce::jlimit (0, numLoadBuckets - 1, (int) (load / loadBucketWidth));
+    increment (loadHistogram[(size_t) bucket]);
+
+    activeVoices.store (numActiveVoices, std::memory_order_relaxed);
+    storeMax (peakVoices, numActiveVoices);
+    voiceSteals.store (numVoiceSteals, std::memory_order_relaxed);
+}
+
+//==============================================================================
+AudioTelemetry::Snapshot AudioTelemetry::getSnapshot() noexcept
+{
+    const auto toMicroseconds = [this] (juce::int64 ticks) { return (double) ticks * 1.0e6 / ticksPerSecond; };
+
+    Snapshot s;
+    s.sampleRate = sampleRate.load (std::memory_order_relaxed);
+    s.blockSize = blockSize.load (std::memory_order_relaxed);
+    s.numBlocks = numBlocks.load (std::memory_order_relaxed);
+
+    const auto lastBlock = lastBlockTicks.load (std::memory_order_relaxed);
+    const auto lastBudget = lastBudgetTicks.load (std::memory_order_relaxed);
+    s.budgetMicroseconds = toMicroseconds (lastBudget);
+    s.lastBlockMicroseconds = toMicroseconds (lastBlock);
+    s.peakBlockMicroseconds = toMicroseconds (peakBlockTicks.exchange (0, std::memory_order_relaxed));
+
+    // The average covers every block since the previous snapshot
+    const auto blockTicks = totalBlockTicks.load (std::memory_order_relaxed);
+    const auto budgetTicks = totalBudgetTicks.load (std::memory_order_relaxed);
+
+    if (budgetTicks > snapshotBudgetTicks)
+        s.averageLoad = (double) (blockTicks - snapshotBlockTicks) / (double) (budgetTicks - snapshotBudgetTicks);
+
+    snapshotBlockTicks = blockTicks;
+    snapshotBudgetTicks = budgetTicks;
+
+    s.lastLoad = lastBudget > 0 ? (double) lastBlock / (double) lastBudget : 0.0;
+    s.peakLoad = peakLoad.exchange (0.0f, std::memory_order_relaxed);
+
+    s.overruns = overruns.load (std::memory_order_relaxed);
+    s.lateCallbacks = lateCallbacks.load (std::memory_order_relaxed);
+
+    s.activeVoices = activeVoices.load (std::memory_order_relaxed);
+    s.peakVoices = peakVoices.exchange (s.activeVoices, std::memory_order_relaxed);
+    s.voiceSteals = (juce::uint64) voiceSteals.load (std::memory_order_relaxed);
+
+    for (size_t i = 0; i < s.loadHistogram.size(); ++i)
+        s.loadHistogram[i] = loadHistogram[i].load (std::memory_order_relaxed);
+
+    return s;
+}
+
+//==============================================================================
+juce::var AudioTelemetry::Snapshot::toVar() const
+{
+    juce::Array<juce::var> histogram;
+
+    for (auto count : loadHistogram)
+        histogram.add ((juce::int64) count);
+
+    auto object = new juce::DynamicObject();
+    object->setProperty ("sampleRate", sampleRate);
+    object->setProperty ("blockSize", blockSize);
+    object->setProperty ("numBlocks", (juce::int64) numBlocks);
+    object->setProperty ("budgetMicroseconds", budgetMicroseconds);
+    object->setProperty ("lastBlockMicroseconds", lastBlockMicroseconds);
+    object->setProperty ("peakBlockMicroseconds", peakBlockMicroseconds);
+    object->setProperty ("lastLoad", lastLoad);
+    object->setProperty ("averageLoad", averageLoad);
+    object->setProperty ("peakLoad", peakLoad);
+    object->setProperty ("overruns", (juce::int64) overruns);
+    object->setProperty ("lateCallbacks", (juce::int64) lateCallbacks);
+    object->setProperty ("deviceXRuns", deviceXRuns);
+    object->setProperty ("activeVoices", activeVoices);
+    object->setProperty ("peakVoices", peakVoices);
+    object->setProperty ("voiceSteals", (juce::int64) voiceSteals);
+    object->setProperty ("loadBucketWidth", loadBucketWidth);
+    object->setProperty ("loadHistogram", histogram);
+    return object;
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    Lock-free health counters for the audio callback.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    Measures how long each audio block takes to render against the time the
+    device gives it, and counts the things that make audio crackle.
+
+    The audio thread calls blockStarted() and blockFinished() around its work.
+    They only do relaxed loads and stores on atomics that no other thread writes,
+    so they never lock or allocate. Any one other thread can call getSnapshot()
+    to read the counters, for display or logging.
+
+    Load is the block's render time as a fraction of its budget, which is the
+    length of the block at the current sample rate. Anything over 1 is an
+    overrun: the callback took longer than the audio it produced, and the device
+    will glitch unless it has spare buffering. A late callback is one that started
+    more than one and a half blocks after the previous one, which usually means
+    the device or OS dropped a buffer, even where it doesn't report xruns itself.
+*/
+class AudioTelemetry
+{
+public:
+    /** The load histogram has buckets 10% wide. The last one also counts every block above 190%. */
+    static constexpr int numLoadBuckets = 20;
+    static constexpr double loadBucketWidth = 0.1;
+
+    struct Snapshot
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        juce::uint64 numBlocks = 0;
+
+        double budgetMicroseconds = 0.0;        // of the most recent block
+        double lastBlockMicroseconds = 0.0;
+        double peakBlockMicroseconds = 0.0;     // since the previous snapshot
+
+        double lastLoad = 0.0;
+        double averageLoad = 0.0;               // since the previous snapshot
+        double peakLoad = 0.0;                  // since the previous snapshot
+
+        juce::uint64 overruns = 0;
+        juce::uint64 lateCallbacks = 0;
+        int deviceXRuns = -1;                   // filled in by the host, or -1 if the device can't tell
+
+        int activeVoices = 0;
+        int peakVoices = 0;                     // since the previous snapshot
+        juce::uint64 voiceSteals = 0;
+
+        std::array<juce::uint64, (size_t) numLoadBuckets> loadHistogram {};
+
+        /** The snapshot as a JSON-friendly object. */
+        juce::var toVar() const;
+    };
+
+    AudioTelemetry() = default;
+
+    /** Sets the sample rate used to work out each block's budget. Call before the
+        audio thread starts, for example from audioDeviceAboutToStart().
+    */
+    void prepare (double sampleRate) noexcept;
+
+    /** Call at the very start of the audio callback. Returns a value to pass to blockFinished(). */
+    juce::int64 blockStarted() noexcept;
+
+    /** Call at the end of the audio callback. */
+    void blockFinished (juce::int64 startTicks, int numSamples, int numActiveVoices, int numVoiceSteals) noexcept;
+
+    /** Reads the counters. Values described as "since the previous snapshot" are reset,
+        so only one thread should take snapshots.
+    */
+    Snapshot getSnapshot() noexcept;
+
+private:
+    //==============================================================================
+    template <typename Type>
+    static void increment (std::atomic<Type>& counter) noexcept
+    {
+        // Only the audio thread writes, so there's no need for an atomic read-modify-write
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    template <typename Type>
+    static void storeMax (std::atomic<Type>& peak, Type value) noexcept
+    {
+        if (value > peak.load (std::memory_order_relaxed))
+            peak.store (value, std::memory_order_relaxed);
+    }
+
+    // Written by the audio thread
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<int> blockSize { 0 };
+    std::atomic<juce::uint64> numBlocks { 0 }, overruns { 0 }, lateCallbacks { 0 };
+    std::atomic<juce::uint64> totalBlockTicks { 0 }, totalBudgetTicks { 0 };
+    std::atomic<juce::int64> lastBlockTicks { 0 }, lastBudgetTicks { 0 }, peakBlockTicks { 0 };
+    std::atomic<float> peakLoad { 0.0f };
+    std::atomic<int> activeVoices { 0 }, peakVoices { 0 }, voiceSteals { 0 };
+    std::array<std::atomic<juce::uint64>, (size_t) numLoadBuckets> loadHistogram {};
+
+    // Only touched by the audio thread
+    juce::int64 previousStartTicks = 0;
+    juce::int64 previousBudgetTicks = 0;
+
+    // Only touched by the thread taking snapshots
+    juce::uint64 snapshotBlockTicks = 0, snapshotBudgetTicks = 0;
+
+    const double ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioTelemetry)
+};
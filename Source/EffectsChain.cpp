@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    The chorus, delay and reverb applied to the voice mix.
+
+  ==============================================================================
+*/
+
+#include "EffectsChain.h"
+
+namespace
+{
+    /** How quickly each effect's mix follows its parameter. */
+    constexpr double mixRampSeconds = 0.05;
+
+    /** How long the delay takes to glide to a new time, as the tempo or division changes. */
+    constexpr double delayRampSeconds = 0.2;
+
+    /** The chorus's centre delay, and the longest it can delay anything once it's swept. */
+    constexpr float chorusCentreDelayMs = 7.0f;
+    constexpr double chorusMemorySeconds = 0.05;
+
+    /** A stand-in until an impulse response is loaded: decorrelated noise in each
+        channel, decaying by 60 dB over two seconds. The seed is fixed, so renders
+        come out the same every time.
+    */
+    juce::AudioBuffer<float> makeRoomImpulseResponse (double sampleRate)
+    {
+        constexpr double decaySeconds = 2.0;
+        const auto length = (int) (decaySeconds * sampleRate);
+        const auto decayPerSample = std::log (1000.0) / length;
+
+        juce::AudioBuffer<float> ir (2, length);
+        juce::Random random (0x5eed);
+
+        for (int channel = 0; channel < ir.getNumChannels(); ++channel)
+        {
+            auto* data = ir.getWritePointer (channel);
+
+            for (int i = 0; i < length; ++i)
+                data[i] = (float) (std::exp (-decayPerSample * i) * (2.0 * random.nextDouble() - 1.0));
+        }
+
+        return ir;
+    }
+}
+
+//==============================================================================
+void EffectsChain::prepare (double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    blockSize = maximumBlockSize;
+
+    const juce::dsp::ProcessSpec spec { sampleRate, (juce::uint32) maximumBlockSize, 2 };
+
+    // The chorus is run fully wet and mixed in by mixIn(), like the others
+    chorus.prepare (spec);
+    chorus.setCentreDelay (chorusCentreDelayMs);
+    chorus.setFeedback (0.0f);
+    chorus.setMix (1.0f);
+    chorusMemory = (int) std::ceil (chorusMemorySeconds * sampleRate) + maximumBlockSize;
+
+    delay.setMaximumDelayInSamples ((int) std::ceil (maxDelaySeconds * sampleRate));
+    delay.prepare (spec);
+
+    if (! hasImpulseResponse.exchange (true))
+        reverb.loadImpulseResponse (makeRoomImpulseResponse (sampleRate), sampleRate,
+                                    juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::no,
+                                    juce::dsp::Convolution::Normalise::yes);
+
+    // This also finishes loading the last impulse response given, so it's there from the first block
+    reverb.prepare (spec);
+
+    wetBuffer.setSize (3, maximumBlockSize);
+
+    for (auto* mix : { &chorusMix, &delayMix, &reverbMix })
+        mix->reset (sampleRate, mixRampSeconds);
+
+    delaySamples.reset (sampleRate, delayRampSeconds);
+    chorusTail = delayTail = reverbTail = {};
+}
+
+void EffectsChain::loadImpulseResponse (const juce::File& file)
+{
+    // The convolution reads, resamples and partitions it on the shared queue's thread
+    reverb.loadImpulseResponse (file, juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::yes, 0);
+    hasImpulseResponse = true;
+}
+
+//==============================================================================
+void EffectsChain::process (float* left, float* right, int numSamples, const Settings& settings) noexcept
+{
+    jassert (numSamples <= wetBuffer.getNumSamples());
+
+    const juce::ScopedNoDenormals noDenormals;
+
+    processChorus (left, right, numSamples, settings);
+    processDelay (left, right, numSamples, settings);
+    processReverb (left, right, numSamples, settings);
+}
+
+void EffectsChain::processChorus (float* left, float* right, int numSamples, const Settings& settings) noexcept
+{
+    if (! updateMix (chorusMix, settings.chorusMix))
+    {
+        if (chorusTail.stop())
+            chorus.reset();
+
+        return;
+    }
+
+    const auto inputSilent = isSilent (left, right, numSamples);
+    const auto ringing = chorusTail.isRinging (chorusMemory);
+    chorusTail.update (inputSilent, numSamples);
+
+    if (inputSilent && ! ringing)
+    {
+        chorusMix.skip (numSamples);
+        return;
+    }
+
+    chorus.setRate (settings.chorusRate);
+    chorus.setDepth (juce::jlimit (0.0f, 1.0f, settings.chorusDepth));
+
+    float* wet[] = { wetBuffer.getWritePointer (0), wetBuffer.getWritePointer (1) };
+    juce::FloatVectorOperations::copy (wet[0], left, numSamples);
+    juce::FloatVectorOperations::copy (wet[1], right, numSamples);
+
+    juce::dsp::AudioBlock<float> block (wet, 2, (size_t) numSamples);
+    chorus.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+    mixIn (chorusMix, left, right, numSamples, true);
+}
+
+void EffectsChain::processDelay (float* left, float* right, int numSamples, const Settings& settings) noexcept
+{
+    if (! updateMix (delayMix, settings.delayMix))
+    {
+        if (delayTail.stop())
+            delay.reset();
+
+        return;
+    }
+
+    const auto beatSeconds = 60.0 / juce::jmax (1.0f, settings.tempo);
+    const auto targetSamples = juce::jlimit (1.0f, (float) (maxDelaySeconds * sampleRate) - 1.0f,
+                                             (float) (settings.delayBeats * beatSeconds * sampleRate));
+
+    // Everything in the line comes out within one delay time, and only goes back in
+    // through the feedback, so once the input and the echoes have been silent for that
+    // long, the line is empty
+    const auto memory = (int) juce::jmax (delaySamples.getCurrentValue(), targetSamples) + 1;
+    const auto inputSilent = isSilent (left, right, numSamples);
+    const auto ringing = delayTail.isRinging (memory);
+
+    // A new time only needs a glide if there's something in the line to bend
+    if (ringing)
+        delaySamples.setTargetValue (targetSamples);
+    else
+        delaySamples.setCurrentAndTargetValue (targetSamples);
+
+    if (inputSilent && ! ringing)
+    {
+        delayMix.skip (numSamples);
+        return;
+    }
+
+    const auto feedback = juce::jlimit (0.0f, maxDelayFeedback, settings.delayFeedback);
+    auto* wetLeft = wetBuffer.getWritePointer (0);
+    auto* wetRight = wetBuffer.getWritePointer (1);
+    auto wetPeak = 0.0f;
+
+    for (int s = 0; s < numSamples; ++s)
+    {
+        const auto time = delaySamples.getNextValue();
+
+        wetLeft[s] = delay.popSample (0, time);
+        wetRight[s] = delay.popSample (1, time);
+        delay.pushSample (0, left[s] + feedback * wetLeft[s]);
+        delay.pushSample (1, right[s] + feedback * wetRight[s]);
+
+        wetPeak = juce::jmax (wetPeak, std::abs (wetLeft[s]), std::abs (wetRight[s]));
+    }
+
+    delayTail.update (inputSilent && wetPeak <= silenceThreshold, numSamples);
+    mixIn (delayMix, left, right, numSamples, false);
+}
+
+void EffectsChain::processReverb (float* left, float* right, int numSamples, const Settings& settings) noexcept
+{
+    if (! updateMix (reverbMix, settings.reverbMix))
+    {
+        if (reverbTail.stop())
+            reverb.reset();
+
+        return;
+    }
+
+    // The convolution holds on to its input for the length of the impulse response,
+    // plus what it buffers to fill its partitions
+    const auto memory = reverb.getCurrentIRSize() + reverb.getLatency() + blockSize;
+    const auto inputSilent = isSilent (left, right, numSamples);
+    const auto ringing = reverbTail.isRinging (memory);
+    reverbTail.update (inputSilent, numSamples);
+
+    if (inputSilent && ! ringing)
+    {
+        reverbMix.skip (numSamples);
+        return;
+    }
+
+    float* wet[] = { wetBuffer.getWritePointer (0), wetBuffer.getWritePointer (1) };
+    juce::FloatVectorOperations::copy (wet[0], left, numSamples);
+    juce::FloatVectorOperations::copy (wet[1], right, numSamples);
+
+    juce::dsp::AudioBlock<float> block (wet, 2, (size_t) numSamples);
+    reverb.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+    mixIn (reverbMix, left, right, numSamples, false);
+}
+
+//==============================================================================
+bool EffectsChain::isSilent (const float* left, const float* right, int numSamples) noexcept
+{
+    const auto leftRange = juce::FloatVectorOperations::findMinAndMax (left, numSamples);
+    const auto rightRange = juce::FloatVectorOperations::findMinAndMax (right, numSamples);
+
+    return juce::jmax (-leftRange.getStart(), leftRange.getEnd(), -rightRange.getStart(), rightRange.getEnd()) <= silenceThreshold;
+}
+
+bool EffectsChain::updateMix (juce::SmoothedValue<float>& mix, float target) noexcept
+{
+    mix.setTargetValue (juce::jlimit (0.0f, 1.0f, target));
+    return mix.isSmoothing() || mix.getTargetValue() > 0.0f;
+}
+
+void EffectsChain::mixIn (juce::SmoothedValue<float>& mix, float* left, float* right, int numSamples, bool crossfade) noexcept
+{
+    auto* wetLeft = wetBuffer.getWritePointer (0);
+    auto* wetRight = wetBuffer.getWritePointer (1);
+    auto* gain = wetBuffer.getWritePointer (2);
+
+    if (mix.isSmoothing())
+    {
+        for (int s = 0; s < numSamples; ++s)
+            gain[s] = mix.getNextValue();
+    }
+    else
+    {
+        juce::FloatVectorOperations::fill (gain, mix.getTargetValue(), numSamples);
+    }
+
+    // A crossfade moves the dry signal towards the wet one, rather than adding to it
+    if (crossfade)
+    {
+        juce::FloatVectorOperations::subtract (wetLeft, left, numSamples);
+        juce::FloatVectorOperations::subtract (wetRight, right, numSamples);
+    }
+
+    juce::FloatVectorOperations::addWithMultiply (left, wetLeft, gain, numSamples);
+    juce::FloatVectorOperations::addWithMultiply (right, wetRight, gain, numSamples);
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    The chorus, delay and reverb applied to the voice mix.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+//==============================================================================
+/**
+    The effects bus: a chorus, a tempo-synced delay and a convolution reverb, in
+    that order, run over the voice mix before the master volume.
+
+    The reverb uses juce::dsp::Convolution with non-uniform partitions: a short
+    head is convolved in small, low-latency blocks and the rest of the impulse
+    response in progressively larger ones, so the cost of each block stays flat
+    however long the tail is. Impulse responses are read, resampled and
+    transformed on a background thread, which every EffectsChain in the process
+    shares; the audio thread crossfades to a new one once it's ready. Until one
+    is loaded, the reverb uses a generated two-second room.
+
+    Each effect keeps track of how long its input, and anything it's fed back to
+    itself, has been below silenceThreshold. Once that's longer than the effect can
+    remember, its output would be silent too, so it isn't processed at all until
+    something comes in again. An effect whose mix is zero is reset and skipped.
+
+    process() flushes denormals itself, because the delay's feedback and the
+    reverb's tail decay into them.
+*/
+class EffectsChain
+{
+public:
+    EffectsChain() = default;
+
+    /** The effects' settings, in the units of the matching ParameterIDs. */
+    struct Settings
+    {
+        float chorusMix = 0.0f, chorusRate = 0.8f, chorusDepth = 0.3f;
+        float delayMix = 0.0f, delayBeats = 0.75f, delayFeedback = 0.35f, tempo = 120.0f;
+        float reverbMix = 0.0f;
+    };
+
+    /** The longest delay, whatever the tempo. */
+    static constexpr double maxDelaySeconds = 4.0;
+
+    /** The most delay feedback allowed, so the repeats always die away. */
+    static constexpr float maxDelayFeedback = 0.95f;
+
+    /** Anything quieter than this, about -100 dB, counts as silence. */
+    static constexpr float silenceThreshold = 1.0e-5f;
+
+    //==============================================================================
+    /** Allocates everything the effects need. Not called on the audio thread. */
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    /** Hands a WAV or AIFF impulse response to the reverb. It's loaded in the
+        background, so call from any thread but the audio thread.
+    */
+    void loadImpulseResponse (const juce::File& file);
+
+    /** Runs the effects over a stereo mix, in place. numSamples must be no more than
+        the block size given to prepare().
+    */
+    void process (float* left, float* right, int numSamples, const Settings&) noexcept;
+
+private:
+    //==============================================================================
+    /** How long an effect's input and feedback have been silent. */
+    struct Tail
+    {
+        static constexpr int idle = std::numeric_limits<int>::max() / 2;
+
+        int silentFor = idle;
+
+        bool isRinging (int memoryLength) const noexcept   { return silentFor < memoryLength; }
+        void update (bool silent, int numSamples) noexcept  { silentFor = silent ? juce::jmin (idle, silentFor + numSamples) : 0; }
+
+        /** Returns true if the effect may still have been holding something. */
+        bool stop() noexcept                                { return std::exchange (silentFor, idle) != idle; }
+    };
+
+    static bool isSilent (const float* left, const float* right, int numSamples) noexcept;
+    static bool updateMix (juce::SmoothedValue<float>& mix, float target) noexcept;
+
+    void processChorus (float* left, float* right, int numSamples, const Settings&) noexcept;
+    void processDelay (float* left, float* right, int numSamples, const Settings&) noexcept;
+    void processReverb (float* left, float* right, int numSamples, const Settings&) noexcept;
+    void mixIn (juce::SmoothedValue<float>& mix, float* left, float* right, int numSamples, bool crossfade) noexcept;
+
+    double sampleRate = 44100.0;
+    int blockSize = 0;
+    int chorusMemory = 0;                                   // samples
+
+    juce::dsp::Chorus<float> chorus;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delay;
+    juce::SharedResourcePointer<juce::dsp::ConvolutionMessageQueue> convolutionQueue;
+    juce::dsp::Convolution reverb { juce::dsp::Convolution::NonUniform { 256 }, *convolutionQueue };
+    std::atomic<bool> hasImpulseResponse { false };
+
+    juce::SmoothedValue<float> chorusMix, delayMix, reverbMix;
+    juce::SmoothedValue<float> delaySamples;
+    Tail chorusTail, delayTail, reverbTail;
+
+    // Channels 0 and 1 are an effect's wet output, channel 2 the per-sample mix
+    juce::AudioBuffer<float> wetBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EffectsChain)
+};
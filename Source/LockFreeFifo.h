@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    Single-producer, single-consumer queue for passing items between threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    A bounded, wait-free queue of trivially copyable items, built on juce::AbstractFifo.
+
+    Exactly one thread may push and exactly one other thread may pop. The storage
+    is allocated in the constructor, so neither side ever allocates or locks, which
+    makes it safe to use from the audio thread.
+*/
+template <typename ItemType>
+class LockFreeFifo
+{
+public:
+    explicit LockFreeFifo (int capacity)
+        : fifo (capacity + 1),      // AbstractFifo keeps one slot empty
+          items ((size_t) capacity + 1)
+    {
+        static_assert (std::is_trivially_copyable_v<ItemType>, "Items are copied with plain assignment");
+    }
+
+    /** Adds an item. Returns false, dropping the item, if the queue is full. */
+    bool push (const ItemType& item) noexcept
+    {
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 > 0)
+        {
+            items[(size_t) scope.startIndex1] = item;
+            return true;
+        }
+
+        if (scope.blockSize2 > 0)
+        {
+            items[(size_t) scope.startIndex2] = item;
+            return true;
+        }
+
+        return false;
+    }
+
+    /** Removes the oldest item. Returns false if the queue is empty. */
+    bool pop (ItemType& item) noexcept
+    {
+        const auto scope = fifo.read (1);
+
+        if (scope.blockSize1 > 0)
+        {
+            item = items[(size_t) scope.startIndex1];
+            return true;
+        }
+
+        if (scope.blockSize2 > 0)
+        {
+            item = items[(size_t) scope.startIndex2];
+            return true;
+        }
+
+        return false;
+    }
+
+    int getNumReady() const noexcept        { return fifo.getNumReady(); }
+    int getFreeSpace() const noexcept       { return fifo.getFreeSpace(); }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<ItemType> items;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LockFreeFifo)
+};
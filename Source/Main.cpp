@@ -24,7 +24,13 @@ public:
     void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
-        mainWindow.reset (new MainWindow (getApplicationName()));
+        // Render workers are off unless asked for with --render-threads N
+        juce::ArgumentList args (getApplicationName(), commandLine);
+        const auto numRenderThreads = args.containsOption ("--render-threads")
+                                          ? args.getValueForOption ("--render-threads").getIntValue()
+                                          : 0;
+
+        mainWindow.reset (new MainWindow (getApplicationName(), numRenderThreads));
     }
 
     void shutdown() override
@@ -56,14 +62,14 @@ public:
     class MainWindow    : public juce::DocumentWindow
     {
     public:
-        MainWindow (juce::String name)
+        MainWindow (juce::String name, int numRenderThreads)
             : DocumentWindow (name,
                               juce::Desktop::getInstance().getDefaultLookAndFeel()
                                                           .findColour (juce::ResizableWindow::backgroundColourId),
                               DocumentWindow::allButtons)
         {
             setUsingNativeTitleBar (true);
-            auto* content = new MainComponent();
+            auto* content = new MainComponent (numRenderThreads);
             setContentOwned (content, true);
             content->setVisible (true);
 
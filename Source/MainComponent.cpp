@@ -9,25 +9,82 @@
 #include "MainComponent.h"
 #include <cstring>
 
+#if SYNTH_EMBEDDED_UI
+ #include <BinaryData.h>
+#endif
+
+namespace
+{
+    /** How often audio telemetry is sent to the web UI. */
+    constexpr int telemetryIntervalMs = 250;
+
+    /** How many UI updates there are between each write of the telemetry file. */
+    constexpr int telemetryTicksPerDump = 20;
+}
+
 //==============================================================================
-MainComponent::MainComponent()
+MainComponent::MainComponent (int numRenderThreads)
 {
     setSize (1000, 800);
     setVisible (true);
     setOpaque (true);
     
+    // Render workers are opt-in: each one is a realtime thread pinned to a core, which
+    // isn't worth it unless patches are big and there are cores to spare
+    synthEngine.setNumRenderThreads (numRenderThreads);
+    
+    // Live playback starts at 2x oversampling, which the UI's Quality menu can change;
+    // offline renders choose their own (see RenderScript.h)
+    synthEngine.setOversampling (2);
+    
     // Initialize audio device manager
     audioDeviceManager.initialiseWithDefaultDevices (0, 2);
     audioDeviceManager.addAudioCallback (this);
     
+    // An empty identifier receives from every enabled MIDI input. Devices plugged in
+    // later are enabled when the system says the list has changed
+    enableMidiInputs();
+    audioDeviceManager.addMidiInputDeviceCallback ({}, this);
+    midiDeviceListConnection = juce::MidiDeviceListConnection::make ([this] { enableMidiInputs(); });
+    
     // Use JUCE WebView for CSS-based UI (WebBrowserComponent is in juce_gui_extra)
     useWebView = true;
     
+   #if SYNTH_EMBEDDED_UI
+    // The UI, the images it uses and the sprite atlases are built into the app as one
+    // zip (see Tools/SynthUIBundler), so starting up doesn't touch the filesystem
+    resourceProvider = std::make_unique<UIResourceProvider> (BinaryData::UIBundle_zip,
+                                                             (size_t) BinaryData::UIBundle_zipSize);
+   #else
+    // Without the embedded bundle, serve the UI files and the Blackway assets where they
+    // are on disk. The assets folder, and the atlases if they've been packed, sit next to UI/
+    auto uiDirectory = findUIDirectory();
+    
+    if (uiDirectory.isDirectory())
+    {
+        resourceProvider = std::make_unique<UIResourceProvider> (uiDirectory);
+        resourceProvider->addDirectory ("Assets", uiDirectory.getParentDirectory()
+                                                             .getChildFile ("Blackway FX Kit (VST)")
+                                                             .getChildFile ("Assets"));
+        resourceProvider->addDirectory ("Atlases", uiDirectory.getParentDirectory().getChildFile ("Atlases"));
+    }
+   #endif
+    
     // Create WebView with native integration enabled for message passing
     auto options = juce::WebBrowserComponent::Options{}
         .withNativeIntegrationEnabled (true)
+        .withResourceProvider ([this](const juce::String& url) -> std::optional<juce::WebBrowserComponent::Resource> {
+            if (resourceProvider == nullptr)
+                return std::nullopt;
+            
+            return resourceProvider->getResource (url);
+        })
         .withEventListener ("message", [this](const juce::var& message) {
             handleJavaScriptMessage (message);
+        })
+        .withEventListener ("params", [this](const juce::var& payload) {
+            if (! controlDispatcher.applyBatch (payload))
+                DBG ("Ignoring malformed parameter batch");
         });
     
     webView = std::make_unique<juce::WebBrowserComponent> (options);
@@ -41,12 +98,19 @@ MainComponent::MainComponent()
     DBG ("Component visible: " + juce::String (isVisible() ? "YES" : "NO"));
     
     loadWebUI();
+    
+    startTimer (telemetryIntervalMs);
+    visualisation.start();
 }
 
 MainComponent::~MainComponent()
 {
+    stopTimer();
+    midiDeviceListConnection.reset();
+    audioDeviceManager.removeMidiInputDeviceCallback ({}, this);
     audioDeviceManager.removeAudioCallback (this);
     audioDeviceManager.closeAudioDevice();
+    visualisation.stop();
 }
 
 //==============================================================================
@@ -73,27 +137,14 @@ void MainComponent::resized()
         webView->setBounds (getLocalBounds());
 }
 
-void MainComponent::loadWebUI()
+juce::File MainComponent::findUIDirectory()
 {
     // Try multiple locations for UI files
-    juce::File htmlFile;
+    // 1. Try relative to executable (for deployed apps)
+    auto exeDir = juce::File::getSpecialLocation (juce::File::currentExecutableFile).getParentDirectory();
+    auto htmlFile = exeDir.getChildFile ("UI").getChildFile ("ui.html");
     
-    // 1. Try absolute path from known project location (for development)
-    // This works when running from Xcode
-    auto projectRoot = juce::File ("/Users/rjmacbookpro/Development/Synth");
-    htmlFile = projectRoot.getChildFile ("UI").getChildFile ("ui.html");
-    
-    DBG ("Trying project root: " + htmlFile.getFullPathName());
-    DBG ("Exists: " + juce::String (htmlFile.existsAsFile() ? "YES" : "NO"));
-    
-    // 2. Try relative to executable (for deployed apps)
-    if (!htmlFile.existsAsFile())
-    {
-        auto exeDir = juce::File::getSpecialLocation (juce::File::currentExecutableFile).getParentDirectory();
-        htmlFile = exeDir.getChildFile ("UI").getChildFile ("ui.html");
-    }
-    
-    // 3. Try relative to current working directory (for development)
+    // 2. Try relative to current working directory (for development)
     if (!htmlFile.existsAsFile())
     {
         auto cwd = juce::File::getCurrentWorkingDirectory();
@@ -109,7 +160,7 @@ void MainComponent::loadWebUI()
         }
     }
     
-    // 4. Try relative to app bundle Resources (for macOS)
+    // 3. Try relative to app bundle Resources (for macOS)
     if (!htmlFile.existsAsFile())
     {
         auto appDir = juce::File::getSpecialLocation (juce::File::currentApplicationFile);
@@ -125,126 +176,19 @@ void MainComponent::loadWebUI()
     DBG ("Looking for UI file at: " + htmlFile.getFullPathName());
     DBG ("File exists: " + juce::String (htmlFile.existsAsFile() ? "YES" : "NO"));
     
-    if (htmlFile.existsAsFile())
+    return htmlFile.existsAsFile() ? htmlFile.getParentDirectory() : juce::File();
+}
+
+void MainComponent::loadWebUI()
+{
+    if (resourceProvider != nullptr)
     {
-        // Read HTML file and inline CSS/JS to avoid path issues
-        auto htmlContent = htmlFile.loadFileAsString();
-        auto uiDir = htmlFile.getParentDirectory();
-        
-        DBG ("HTML file loaded, length: " + juce::String (htmlContent.length()));
-        
-        // Try to read and inline CSS
-        auto cssFile = uiDir.getChildFile ("styles.css");
-        if (cssFile.existsAsFile())
-        {
-            auto cssContent = cssFile.loadFileAsString();
-            DBG ("CSS file loaded, length: " + juce::String (cssContent.length()));
-            
-            // Replace <link rel="stylesheet" href="styles.css"> with inline style
-            // Try multiple variations of the link tag
-            htmlContent = htmlContent.replace ("<link rel=\"stylesheet\" href=\"styles.css\">",
-                                               "<style>" + cssContent + "</style>");
-            htmlContent = htmlContent.replace ("<link rel=\"stylesheet\" href=\"styles.css\" />",
-                                               "<style>" + cssContent + "</style>");
-            htmlContent = htmlContent.replace ("<link rel='stylesheet' href='styles.css'>",
-                                               "<style>" + cssContent + "</style>");
-        }
-        else
-        {
-            DBG ("CSS file not found at: " + cssFile.getFullPathName());
-        }
-        
-        // Try to read and inline JS
-        auto jsFile = uiDir.getChildFile ("app.js");
-        if (jsFile.existsAsFile())
-        {
-            auto jsContent = jsFile.loadFileAsString();
-            DBG ("JS file loaded, length: " + juce::String (jsContent.length()));
-            
-            // Replace <script src="app.js"></script> with inline script
-            // Try multiple variations
-            htmlContent = htmlContent.replace ("<script src=\"app.js\"></script>",
-                                               "<script>" + jsContent + "</script>");
-            htmlContent = htmlContent.replace ("<script src='app.js'></script>",
-                                               "<script>" + jsContent + "</script>");
-        }
-        else
-        {
-            DBG ("JS file not found at: " + jsFile.getFullPathName());
-        }
-        
-        DBG ("Final HTML length: " + juce::String (htmlContent.length()));
-        
-        // Write the inlined HTML to a temporary file and load that
-        // This avoids data URL encoding/decoding issues
-        auto tempDir = juce::File::getSpecialLocation (juce::File::tempDirectory)
-                          .getChildFile ("Synth");
-        tempDir.createDirectory();
-        
-        auto tempFile = tempDir.getChildFile ("SynthUI.html");
-        tempFile.replaceWithText (htmlContent);
-        
-        // Copy other HTML files to temp directory so they can be accessed
-        auto componentsFile = uiDir.getChildFile ("components.html");
-        if (componentsFile.existsAsFile())
-        {
-            auto tempComponentsFile = tempDir.getChildFile ("components.html");
-            componentsFile.copyFileTo (tempComponentsFile);
-            DBG ("Copied components.html to temp directory");
-        }
-        
-        auto demoFile = uiDir.getChildFile ("demo.html");
-        if (demoFile.existsAsFile())
-        {
-            auto tempDemoFile = tempDir.getChildFile ("demo.html");
-            demoFile.copyFileTo (tempDemoFile);
-            DBG ("Copied demo.html to temp directory");
-        }
-        
-        // Copy components.js to temp directory
-        auto componentsJsFile = uiDir.getChildFile ("components.js");
-        if (componentsJsFile.existsAsFile())
-        {
-            auto tempComponentsJsFile = tempDir.getChildFile ("components.js");
-            componentsJsFile.copyFileTo (tempComponentsJsFile);
-            DBG ("Copied components.js to temp directory");
-        }
-        
-        // Copy assets folder to temp directory so they can be referenced
-        auto assetsSource = projectRoot.getChildFile ("Blackway FX Kit (VST)").getChildFile ("Assets");
-        auto assetsDest = tempDir.getChildFile ("Assets");
-        
-        if (assetsSource.exists() && assetsSource.isDirectory())
-        {
-            DBG ("Copying assets to temp directory...");
-            assetsDest.deleteRecursively();
-            assetsSource.copyDirectoryTo (assetsDest);
-            DBG ("Assets copied to: " + assetsDest.getFullPathName());
-        }
-        
-        auto filePath = tempFile.getFullPathName();
-        filePath = filePath.replace (" ", "%20");
-        juce::String fileURL = "file://" + filePath;
-        
-        DBG ("Loading UI from temp file: " + fileURL);
-        
-        // Ensure WebView is visible and properly sized
-        webView->setVisible (true);
-        webView->setBounds (getLocalBounds());
-        webView->toFront (false);
-        
-        // Load the file URL
-        webView->goToURL (fileURL);
-        
-        // Force a repaint
-        repaint();
-        webView->repaint();
-        
-        DBG ("WebView URL loaded, WebView visible: " + juce::String (webView->isVisible() ? "YES" : "NO"));
-        DBG ("WebView bounds: " + webView->getBounds().toString());
-        DBG ("Component visible: " + juce::String (isVisible() ? "YES" : "NO"));
-        DBG ("Component bounds: " + getBounds().toString());
+        // The provider serves ui.html, its scripts and styles, and the images, so
+        // nothing needs inlining or copying first
+        auto rootURL = juce::WebBrowserComponent::getResourceProviderRoot();
+        DBG ("Loading UI from resource provider: " + rootURL);
         
+        webView->goToURL (rootURL);
         return;
     }
     
@@ -273,7 +217,8 @@ void MainComponent::loadWebUI()
 
 void MainComponent::handleJavaScriptMessage (const juce::var& message)
 {
-    // Handle messages from JavaScript
+    // Handle the occasional discrete messages from JavaScript. Control changes
+    // arrive batched as "params" events instead (see UIProtocol.h).
     // Message can be a JSON string or already parsed var
     juce::var parsedMessage = message;
     
@@ -292,98 +237,75 @@ void MainComponent::handleJavaScriptMessage (const juce::var& message)
     if (auto* obj = parsedMessage.getDynamicObject())
     {
         auto type = obj->getProperty ("type").toString();
-        auto value = obj->getProperty ("value");
         
-        if (type == "volume")
-        {
-            auto volumeValue = (float) value;
-            DBG ("Volume changed: " + juce::String (volumeValue));
-            currentVolume = volumeValue / 100.0f; // Convert 0-100 to 0.0-1.0
-        }
-        else if (type == "frequency")
+        if (type == "playNote")
         {
-            auto freqValue = (float) value;
-            DBG ("Frequency changed: " + juce::String (freqValue));
-            currentFrequency = (double) freqValue;
-            // Update phase delta if audio is already started
-            if (sampleRate > 0.0)
-                phaseDelta = juce::MathConstants<double>::twoPi * currentFrequency / sampleRate;
-        }
-        else if (type == "detune")
-        {
-            auto detuneValue = (float) value;
-            DBG ("Detune changed: " + juce::String (detuneValue));
-            // TODO: Update detune
-            // audioEngine.setDetune (detuneValue);
-        }
-        else if (type == "waveform")
-        {
-            auto waveformValue = value.toString();
-            DBG ("Waveform changed: " + waveformValue);
-            currentWaveform = waveformValue;
-        }
-        else if (type == "attack")
-        {
-            auto attackValue = (float) value;
-            DBG ("Attack changed: " + juce::String (attackValue));
-            // TODO: Update attack time
-            // audioEngine.setAttack (attackValue / 1000.0f);
+            DBG ("Play note triggered");
+            
+            // Messages may name a MIDI note; otherwise play the frequency slider's pitch
+            auto note = obj->getProperty ("note");
+            
+            if (note.isVoid())
+                synthEngine.noteOn (SynthEngine::uiNoteKey, synthEngine.getParameters().get (ParameterID::noteFrequency), 1.0f);
+            else
+            {
+                auto noteNumber = juce::jlimit (0, 127, (int) note);
+                synthEngine.noteOn (noteNumber, juce::MidiMessage::getMidiNoteInHertz (noteNumber), 1.0f);
+            }
         }
-        else if (type == "decay")
+        else if (type == "stopNote")
         {
-            auto decayValue = (float) value;
-            DBG ("Decay changed: " + juce::String (decayValue));
-            // TODO: Update decay time
-            // audioEngine.setDecay (decayValue / 1000.0f);
+            DBG ("Stop note triggered");
+            
+            auto note = obj->getProperty ("note");
+            synthEngine.noteOff (note.isVoid() ? SynthEngine::uiNoteKey : juce::jlimit (0, 127, (int) note));
         }
-        else if (type == "sustain")
+        else if (type == "loadPreset")
         {
-            auto sustainValue = (float) value;
-            DBG ("Sustain changed: " + juce::String (sustainValue));
-            // TODO: Update sustain level
-            // audioEngine.setSustain (sustainValue / 100.0f);
+            // Read and parsed off the message thread; the engine switches at its next block
+            presets.loadPreset (obj->getProperty ("name").toString(),
+                                [safeThis = juce::Component::SafePointer<MainComponent> (this)] (const SynthPreset& preset)
+                                {
+                                    if (safeThis != nullptr)
+                                        safeThis->sendLoadedPreset (preset);
+                                });
         }
-        else if (type == "release")
+        else if (type == "savePreset")
         {
-            auto releaseValue = (float) value;
-            DBG ("Release changed: " + juce::String (releaseValue));
-            // TODO: Update release time
-            // audioEngine.setRelease (releaseValue / 1000.0f);
+            auto name = obj->getProperty ("name").toString().trim();
+            
+            if (name.isNotEmpty() && presets.savePreset (name))
+                sendPresetList();
         }
-        else if (type == "cutoff")
+        else if (type == "listPresets")
         {
-            auto cutoffValue = (float) value;
-            DBG ("Cutoff changed: " + juce::String (cutoffValue));
-            // TODO: Update filter cutoff
-            // audioEngine.setCutoff (cutoffValue);
+            sendPresetList();
         }
-        else if (type == "resonance")
+        else if (type == "loadSamples")
         {
-            auto resonanceValue = (float) value;
-            DBG ("Resonance changed: " + juce::String (resonanceValue));
-            // TODO: Update filter resonance
-            // audioEngine.setResonance (resonanceValue);
+            chooseSampleFolder();
         }
-        else if (type == "filterType")
+        else if (type == "loadImpulseResponse")
         {
-            auto filterTypeValue = value.toString();
-            DBG ("Filter type changed: " + filterTypeValue);
-            // TODO: Update filter type
-            // audioEngine.setFilterType (filterTypeValue);
+            chooseImpulseResponse();
         }
-        else if (type == "playNote")
+        else if (type == "modulation")
         {
-            DBG ("Play note triggered");
-            isPlaying = true;
-            currentPhase = 0.0;
-            // Update phase delta based on current frequency
-            if (sampleRate > 0.0)
-                phaseDelta = juce::MathConstants<double>::twoPi * currentFrequency / sampleRate;
+            setModulationRoutes (obj->getProperty ("routes"));
         }
-        else if (type == "stopNote")
+        else if (auto control = UIControlDispatcher::controlFromName (type); control >= 0)
         {
-            DBG ("Stop note triggered");
-            isPlaying = false;
+            // Controls sent one at a time as {type, value}, as older UIs did
+            auto value = obj->getProperty ("value");
+            
+            if (control == (int) UIControl::waveform && value.isString())
+                controlDispatcher.apply (control, (float) waveformFromString (value.toString()));
+            else if (control == (int) UIControl::filterType && value.isString())
+                controlDispatcher.apply (control, (float) filterTypeFromString (value.toString()));
+            else if (control == (int) UIControl::oscillator && value.isString())
+                controlDispatcher.apply (control, (float) oscillatorTypeFromString (value.toString()));
+            else
+                controlDispatcher.apply (control, (float) value);
         }
     }
 }
@@ -398,6 +320,165 @@ void MainComponent::sendMessageToWebView (const juce::var& message)
     }
 }
 
+void MainComponent::sendPresetList()
+{
+    auto* message = new juce::DynamicObject();
+    message->setProperty ("type", "presetList");
+    
+    juce::Array<juce::var> names;
+    
+    for (const auto& name : presets.getPresetNames())
+        names.add (name);
+    
+    message->setProperty ("names", names);
+    sendMessageToWebView (message);
+}
+
+void MainComponent::sendLoadedPreset (const SynthPreset& preset)
+{
+    auto* message = new juce::DynamicObject();
+    message->setProperty ("type", "presetLoaded");
+    message->setProperty ("name", preset.name);
+    message->setProperty ("controls", controlDispatcher.getControlValues (preset));
+    sendMessageToWebView (message);
+}
+
+void MainComponent::chooseSampleFolder()
+{
+    fileChooser = std::make_unique<juce::FileChooser> ("Choose a folder of samples",
+                                                       juce::File::getSpecialLocation (juce::File::userMusicDirectory));
+    
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+                              [this] (const juce::FileChooser& chooser)
+                              {
+                                  if (auto folder = chooser.getResult(); folder.isDirectory())
+                                      loadSampleFolder (folder);
+                              });
+}
+
+void MainComponent::loadSampleFolder (const juce::File& folder)
+{
+    // Mapping the files and reading their heads takes a while for a big library
+    backgroundJobs.addJob ([this, folder, safeThis = juce::Component::SafePointer<MainComponent> (this)]
+    {
+        juce::String error;
+        auto library = SampleLibrary::loadDirectory (folder, error);
+        const auto name = library != nullptr ? library->getName() : juce::String();
+        
+        if (library != nullptr)
+            synthEngine.loadSamples (std::move (library));
+        
+        juce::MessageManager::callAsync ([safeThis, name, error]
+        {
+            if (safeThis == nullptr)
+                return;
+            
+            auto* message = new juce::DynamicObject();
+            message->setProperty ("type", "samplesLoaded");
+            message->setProperty ("name", name);
+            message->setProperty ("error", error);
+            safeThis->sendMessageToWebView (message);
+        });
+    });
+}
+
+void MainComponent::chooseImpulseResponse()
+{
+    fileChooser = std::make_unique<juce::FileChooser> ("Choose an impulse response",
+                                                       juce::File::getSpecialLocation (juce::File::userMusicDirectory),
+                                                       "*.wav;*.aif;*.aiff");
+    
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& chooser)
+                              {
+                                  auto file = chooser.getResult();
+                                  
+                                  if (! file.existsAsFile())
+                                      return;
+                                  
+                                  synthEngine.loadImpulseResponse (file);
+                                  
+                                  auto* message = new juce::DynamicObject();
+                                  message->setProperty ("type", "impulseResponseLoaded");
+                                  message->setProperty ("name", file.getFileNameWithoutExtension());
+                                  sendMessageToWebView (message);
+                              });
+}
+
+void MainComponent::setModulationRoutes (const juce::var& routeList)
+{
+    std::vector<ModulationRoute> routes;
+    
+    if (auto* list = routeList.getArray())
+    {
+        for (const auto& route : *list)
+        {
+            routes.push_back ({ modulationSourceFromString (route["source"].toString()),
+                                modulationDestinationFromString (route["destination"].toString()),
+                                (float) route["amount"],
+                                modulationRateFromString (route["rate"].toString()) });
+        }
+    }
+    
+    // Compiled off the message thread; the engine switches to the plan at its next block
+    backgroundJobs.addJob ([this, routes = std::move (routes)]
+    {
+        synthEngine.setModulation (ModulationPlan::compile (routes));
+    });
+}
+
+void MainComponent::postVisualisationFrame (const juce::String& frame)
+{
+    // If the page hasn't been given the last frame yet, drop this one rather than
+    // letting them queue up behind a busy message thread
+    if (visualisationFramePending.exchange (true))
+        return;
+    
+    juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<MainComponent> (this), frame]
+    {
+        if (safeThis == nullptr)
+            return;
+        
+        safeThis->visualisationFramePending = false;
+        
+        if (safeThis->webView != nullptr)
+            safeThis->webView->evaluateJavascript ("window.receiveVisualisation && window.receiveVisualisation('" + frame + "');");
+    });
+}
+
+//==============================================================================
+void MainComponent::timerCallback()
+{
+    // Free presets and modulation plans the audio thread has switched away from
+    synthEngine.releaseRetiredSnapshots();
+    
+    auto snapshot = telemetry.getSnapshot();
+    snapshot.deviceXRuns = audioDeviceManager.getXRunCount();
+    
+    auto data = snapshot.toVar();
+    
+    if (++telemetryTicks >= telemetryTicksPerDump)
+    {
+        telemetryTicks = 0;
+        
+        auto file = getTelemetryFile();
+        file.getParentDirectory().createDirectory();
+        file.replaceWithText (juce::JSON::toString (data));
+    }
+    
+    if (auto* obj = data.getDynamicObject())
+        obj->setProperty ("type", "telemetry");
+    
+    sendMessageToWebView (data);
+}
+
+juce::File MainComponent::getTelemetryFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("Synth")
+               .getChildFile ("telemetry.json");
+}
+
 //==============================================================================
 // Audio callback methods
 void MainComponent::audioDeviceIOCallbackWithContext (const float* const* inputChannelData,
@@ -407,74 +488,49 @@ void MainComponent::audioDeviceIOCallbackWithContext (const float* const* inputC
                                                       int numSamples,
                                                       const juce::AudioIODeviceCallbackContext& context)
 {
-    // Clear output buffers
-    for (int channel = 0; channel < numOutputChannels; ++channel)
-    {
-        juce::FloatVectorOperations::clear (outputChannelData[channel], numSamples);
-    }
+    const auto startTicks = telemetry.blockStarted();
     
-    // Generate audio if playing
-    if (isPlaying)
-    {
-        for (int sample = 0; sample < numSamples; ++sample)
-        {
-            float sampleValue = 0.0f;
-            
-            // Generate waveform based on current selection
-            if (currentWaveform == "sine")
-            {
-                sampleValue = (float) std::sin (currentPhase);
-            }
-            else if (currentWaveform == "square")
-            {
-                sampleValue = (currentPhase < juce::MathConstants<double>::pi) ? 1.0f : -1.0f;
-            }
-            else if (currentWaveform == "sawtooth")
-            {
-                // Sawtooth: linear ramp from -1 to 1
-                sampleValue = (float) ((currentPhase / juce::MathConstants<double>::twoPi) * 2.0 - 1.0);
-            }
-            else if (currentWaveform == "triangle")
-            {
-                // Triangle: linear ramp up then down
-                if (currentPhase < juce::MathConstants<double>::pi)
-                    sampleValue = (float) ((currentPhase / juce::MathConstants<double>::pi) * 2.0 - 1.0);
-                else
-                    sampleValue = (float) (3.0 - (currentPhase / juce::MathConstants<double>::pi) * 2.0);
-            }
-            else
-            {
-                // Default to sine
-                sampleValue = (float) std::sin (currentPhase);
-            }
-            
-            // Apply volume
-            sampleValue *= currentVolume;
-            
-            // Write to all output channels
-            for (int channel = 0; channel < numOutputChannels; ++channel)
-            {
-                outputChannelData[channel][sample] = sampleValue;
-            }
-            
-            // Update phase
-            currentPhase += phaseDelta;
-            if (currentPhase >= juce::MathConstants<double>::twoPi)
-                currentPhase -= juce::MathConstants<double>::twoPi;
-        }
-    }
+    // The engine overwrites every output channel, so there's no need to clear them first.
+    // The host timestamp, where the device has one, lets it place UI events sample-accurately.
+    synthEngine.renderBlock (outputChannelData, numOutputChannels, numSamples, context.hostTimeNs);
+    
+    if (numOutputChannels > 0)
+        visualisation.push (outputChannelData[0], outputChannelData[numOutputChannels > 1 ? 1 : 0], numSamples);
+    
+    telemetry.blockFinished (startTicks, numSamples, synthEngine.getNumActiveVoices(), synthEngine.getNumVoiceSteals());
 }
 
 void MainComponent::audioDeviceAboutToStart (juce::AudioIODevice* device)
 {
     if (device != nullptr)
     {
-        sampleRate = device->getCurrentSampleRate();
-        phaseDelta = juce::MathConstants<double>::twoPi * currentFrequency / sampleRate;
+        auto sampleRate = device->getCurrentSampleRate();
+        synthEngine.prepare (sampleRate, device->getCurrentBufferSizeSamples());
+        telemetry.prepare (sampleRate);
+        visualisation.prepare (sampleRate);
         DBG ("Audio device started, sample rate: " + juce::String (sampleRate));
     }
 }
 
+void MainComponent::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
+{
+    // AudioDeviceManager calls this with a lock held, so only one thread posts at a
+    // time. The message keeps the time it arrived, which the engine uses to place it
+    synthEngine.postMidiMessage (message);
+}
+
+void MainComponent::enableMidiInputs()
+{
+    for (const auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (! audioDeviceManager.isMidiInputDeviceEnabled (device.identifier))
+        {
+            DBG ("Enabling MIDI input: " + device.name);
+            audioDeviceManager.setMidiInputDeviceEnabled (device.identifier, true);
+        }
+    }
+}
+
 void MainComponent::audioDeviceStopped()
 {
     DBG ("Audio device stopped");
@@ -9,17 +9,26 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "AudioTelemetry.h"
+#include "PresetManager.h"
+#include "SynthEngine.h"
+#include "UIProtocol.h"
+#include "UIResourceProvider.h"
+#include "VisualisationFeed.h"
 
 //==============================================================================
 /**
     Main component using JUCE 8 WebView for CSS-based UI
 */
 class MainComponent  : public juce::Component,
-                        public juce::AudioIODeviceCallback
+                        public juce::AudioIODeviceCallback,
+                        private juce::MidiInputCallback,
+                        private juce::Timer
 {
 public:
     //==============================================================================
-    MainComponent();
+    // numRenderThreads goes to SynthEngine::setNumRenderThreads(); 0 renders on the audio thread alone
+    explicit MainComponent (int numRenderThreads = 0);
     ~MainComponent() override;
 
     //==============================================================================
@@ -28,18 +37,30 @@ public:
 
 private:
     //==============================================================================
+    // Serves the UI files to the WebView, so it must outlive it
+    std::unique_ptr<UIResourceProvider> resourceProvider;
+    
     // WebView for CSS-based UI (WebBrowserComponent is in juce_gui_extra)
     std::unique_ptr<juce::WebBrowserComponent> webView;
     
     // Audio components
     juce::AudioDeviceManager audioDeviceManager;
-    bool isPlaying = false;
-    double currentFrequency = 440.0;
-    double currentPhase = 0.0;
-    double phaseDelta = 0.0;
-    float currentVolume = 0.5f;
-    double sampleRate = 44100.0;
-    juce::String currentWaveform = "sine"; // sine, square, sawtooth, triangle
+    juce::MidiDeviceListConnection midiDeviceListConnection;
+    SynthEngine synthEngine;
+    UIControlDispatcher controlDispatcher { synthEngine };
+    PresetManager presets { synthEngine };
+    
+    // Sample folders are chosen on the message thread and mapped on the background one,
+    // which also compiles modulation routes. Impulse responses load on the reverb's own thread
+    std::unique_ptr<juce::FileChooser> fileChooser;
+    juce::ThreadPool backgroundJobs { juce::ThreadPoolOptions{}.withThreadName ("Background jobs")
+                                                               .withNumberOfThreads (1) };
+    AudioTelemetry telemetry;
+    int telemetryTicks = 0;
+    
+    // Meter, scope and spectrum frames for the web UI, analysed off the audio thread
+    VisualisationFeed visualisation { [this] (const juce::String& frame) { postVisualisationFrame (frame); } };
+    std::atomic<bool> visualisationFramePending { false };
     
     // Audio callback methods
     void audioDeviceIOCallbackWithContext (const float* const* inputChannelData,
@@ -52,7 +73,13 @@ private:
     void audioDeviceStopped() override;
     void audioDeviceError (const juce::String& errorMessage) override;
     
-    // Helper to load HTML content
+    // MIDI input, from every connected device, straight to the engine's MIDI queue.
+    // enableMidiInputs() runs at startup and whenever a device is added or removed
+    void handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message) override;
+    void enableMidiInputs();
+    
+    // Helpers to find and load HTML content
+    static juce::File findUIDirectory();
     void loadWebUI();
     
     // Handle messages from JavaScript
@@ -61,6 +88,27 @@ private:
     // Send message to JavaScript
     void sendMessageToWebView (const juce::var& message);
     
+    // Tells the web UI which presets there are, and moves its controls to a loaded one
+    void sendPresetList();
+    void sendLoadedPreset (const SynthPreset& preset);
+    
+    // Asks for a folder of samples, loads it in the background and tells the web UI
+    void chooseSampleFolder();
+    void loadSampleFolder (const juce::File& folder);
+    
+    // Asks for an impulse response file and hands it to the reverb
+    void chooseImpulseResponse();
+    
+    // Compiles the web UI's modulation routes in the background and hands them to the engine
+    void setModulationRoutes (const juce::var& routeList);
+    
+    // Called on the analysis thread; hands the frame to the web UI on the message thread
+    void postVisualisationFrame (const juce::String& frame);
+    
+    // Sends audio telemetry to the web UI, and periodically writes it to disk
+    void timerCallback() override;
+    static juce::File getTelemetryFile();
+    
     // Flag to switch between native and web UI
     bool useWebView = false;
 
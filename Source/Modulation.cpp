@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    Modulation routes, and the flat plans they're compiled into.
+
+  ==============================================================================
+*/
+
+#include "Modulation.h"
+
+ModulationSource modulationSourceFromString (const juce::String& name)
+{
+    if (name == "lfo2")      return ModulationSource::lfo2;
+    if (name == "modWheel")  return ModulationSource::modWheel;
+    if (name == "envelope")  return ModulationSource::envelope;
+    if (name == "velocity")  return ModulationSource::velocity;
+
+    return ModulationSource::lfo1;
+}
+
+ModulationDestination modulationDestinationFromString (const juce::String& name)
+{
+    if (name == "cutoff")    return ModulationDestination::cutoff;
+    if (name == "volume")    return ModulationDestination::volume;
+    if (name == "detune")    return ModulationDestination::detune;
+
+    return ModulationDestination::pitch;
+}
+
+ModulationRate modulationRateFromString (const juce::String& name)
+{
+    return name == "audio" ? ModulationRate::audio : ModulationRate::block;
+}
+
+//==============================================================================
+std::unique_ptr<const ModulationPlan> ModulationPlan::compile (const std::vector<ModulationRoute>& routes)
+{
+    // Merge routes that would run the same multiply-add, so each pair costs one step
+    std::vector<ModulationRoute> merged;
+
+    for (auto route : routes)
+    {
+        if ((int) merged.size() >= maxRoutes)
+            break;
+
+        if (! juce::isPositiveAndBelow ((int) route.source, numModulationSources)
+             || ! juce::isPositiveAndBelow ((int) route.destination, numModulationDestinations)
+             || ! std::isfinite (route.amount))
+            continue;
+
+        if (route.rate == ModulationRate::audio
+             && (isPerVoiceSource (route.source) || route.destination == ModulationDestination::detune))
+            route.rate = ModulationRate::block;
+
+        auto same = std::find_if (merged.begin(), merged.end(), [&route] (const ModulationRoute& r)
+        {
+            return r.source == route.source && r.destination == route.destination && r.rate == route.rate;
+        });
+
+        if (same != merged.end())
+            same->amount += route.amount;
+        else
+            merged.push_back (route);
+    }
+
+    auto plan = std::make_unique<ModulationPlan>();
+
+    for (const auto& route : merged)
+    {
+        if (route.amount == 0.0f)
+            continue;
+
+        const Step step { (juce::uint8) route.source, (juce::uint8) route.destination,
+                          juce::jlimit (-1.0f, 1.0f, route.amount) * getModulationRange (route.destination) };
+
+        if (route.rate == ModulationRate::audio)
+        {
+            plan->audioSteps[(size_t) plan->numAudioSteps++] = step;
+            plan->audioDestinations[(size_t) route.destination] = true;
+        }
+        else if (isPerVoiceDestination (route.destination))
+        {
+            plan->voiceSteps[(size_t) plan->numVoiceSteps++] = step;
+        }
+        else
+        {
+            plan->sharedSteps[(size_t) plan->numSharedSteps++] = step;
+        }
+    }
+
+    return plan;
+}
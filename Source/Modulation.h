@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    Modulation routes, and the flat plans they're compiled into.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/** Where modulation comes from. */
+enum class ModulationSource : juce::uint8
+{
+    lfo1 = 0,       // -1 to 1, a sine at ParameterID::lfo1Rate
+    lfo2,           // -1 to 1, a triangle at ParameterID::lfo2Rate
+    modWheel,       // 0 - 1, MIDI controller 1
+    envelope,       // 0 - 1, the voice's amplitude envelope
+    velocity        // 0 - 1, the voice's note velocity
+};
+
+static constexpr int numModulationSources = 5;
+
+/** True for the sources that have a value per voice rather than one for the whole engine. */
+inline bool isPerVoiceSource (ModulationSource source) noexcept
+{
+    return source == ModulationSource::envelope || source == ModulationSource::velocity;
+}
+
+/** What modulation is applied to. */
+enum class ModulationDestination : juce::uint8
+{
+    pitch = 0,      // semitones
+    cutoff,         // octaves
+    volume,         // added to a gain of 1
+    detune          // cents, added to the unison detune
+};
+
+static constexpr int numModulationDestinations = 4;
+
+/** True for the destinations each voice has its own value of. The filter and the
+    unison tuning are shared by every voice, so cutoff and detune are modulated for
+    the whole engine, and their per-voice sources follow the newest note.
+*/
+inline bool isPerVoiceDestination (ModulationDestination destination) noexcept
+{
+    return destination == ModulationDestination::pitch || destination == ModulationDestination::volume;
+}
+
+/** How far a route with an amount of 1 moves a destination, in its units. */
+inline float getModulationRange (ModulationDestination destination) noexcept
+{
+    switch (destination)
+    {
+        case ModulationDestination::pitch:      return 12.0f;
+        case ModulationDestination::cutoff:     return 4.0f;
+        case ModulationDestination::volume:     return 1.0f;
+        case ModulationDestination::detune:     return 50.0f;
+    }
+
+    return 0.0f;
+}
+
+/** How often a route is evaluated. */
+enum class ModulationRate : juce::uint8
+{
+    block = 0,      // once per control block, like the parameters
+    audio           // every rendered sample
+};
+
+/** These convert the names scripts and the web UI use. Unknown names give the first value. */
+ModulationSource modulationSourceFromString (const juce::String& name);
+ModulationDestination modulationDestinationFromString (const juce::String& name);
+ModulationRate modulationRateFromString (const juce::String& name);
+
+//==============================================================================
+/** One connection in the modulation matrix, as the user edits it. */
+struct ModulationRoute
+{
+    ModulationSource source = ModulationSource::lfo1;
+    ModulationDestination destination = ModulationDestination::pitch;
+    float amount = 0.0f;                    // -1 to 1, of getModulationRange()
+    ModulationRate rate = ModulationRate::block;
+};
+
+//==============================================================================
+/**
+    A set of routes compiled into the lists of multiply-adds the audio thread runs.
+
+    compile() does everything that depends on the routes but not on the sound: it
+    drops routes that do nothing, merges routes that share a source, destination
+    and rate, scales each amount into its destination's units, and sorts what's
+    left by where and how often it has to run. A route can only run at audio rate
+    from a source shared by every voice to pitch, cutoff or volume; anything else
+    that asks for audio rate runs per block instead, where it costs the same.
+
+    A plan never changes after it's compiled, so it can be handed to the audio
+    thread with SynthEngine::setModulation() and read there without locking.
+*/
+struct ModulationPlan
+{
+    /** destinations[destination] += sources[source] * amount */
+    struct Step
+    {
+        juce::uint8 source = 0, destination = 0;
+        float amount = 0.0f;
+    };
+
+    static constexpr int maxRoutes = 16;
+
+    /** Allocates, so call it on a background thread. Routes past maxRoutes are ignored. */
+    static std::unique_ptr<const ModulationPlan> compile (const std::vector<ModulationRoute>& routes);
+
+    /** Runs a list of steps. Every step is the same multiply-add, so there are no
+        branches, and the destinations should be cleared first.
+    */
+    static void run (const Step* steps, int numSteps, const float* sources, float* destinations) noexcept
+    {
+        for (int i = 0; i < numSteps; ++i)
+            destinations[steps[i].destination] += sources[steps[i].source] * steps[i].amount;
+    }
+
+    // Block-rate routes to pitch and volume, run for each voice
+    std::array<Step, maxRoutes> voiceSteps;
+    int numVoiceSteps = 0;
+
+    // Block-rate routes to cutoff and detune, run once per block
+    std::array<Step, maxRoutes> sharedSteps;
+    int numSharedSteps = 0;
+
+    // Audio-rate routes, run once per sample
+    std::array<Step, maxRoutes> audioSteps;
+    int numAudioSteps = 0;
+    std::array<bool, numModulationDestinations> audioDestinations {};   // which ones audioSteps write to
+};
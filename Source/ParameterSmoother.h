@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    Per-sample ramps that remove zipper noise from parameter changes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    Ramps a value towards a target over a fixed time, either linearly or
+    exponentially. The exponential ramp moves by a constant ratio per sample,
+    which sounds even for pitch and cutoff; it needs values above zero.
+
+    Everything except prepare() is allocation-free and meant for the audio thread.
+*/
+class ParameterSmoother
+{
+public:
+    enum class Ramp
+    {
+        linear,
+        exponential
+    };
+
+    ParameterSmoother() = default;
+
+    void prepare (double sampleRate, double rampSeconds, Ramp newRamp) noexcept
+    {
+        ramp = newRamp;
+        rampLength = juce::jmax (1, (int) std::floor (rampSeconds * sampleRate));
+        setCurrentAndTarget (target);
+    }
+
+    /** Jumps straight to a value, with no ramp. */
+    void setCurrentAndTarget (float newValue) noexcept
+    {
+        current = target = newValue;
+        countdown = 0;
+    }
+
+    /** Starts a new ramp from the current value if the target has changed. */
+    void setTarget (float newTarget) noexcept
+    {
+        if (newTarget == target)
+            return;
+
+        target = newTarget;
+        countdown = rampLength;
+
+        // Exponential ramps fall back to linear ones if either end isn't positive
+        multiplicative = ramp == Ramp::exponential && current > 0.0f && target > 0.0f;
+
+        if (multiplicative)
+            step = std::exp (std::log (target / current) / (float) rampLength);
+        else
+            step = (target - current) / (float) rampLength;
+    }
+
+    bool isSmoothing() const noexcept       { return countdown > 0; }
+    float getCurrentValue() const noexcept  { return current; }
+    float getTargetValue() const noexcept   { return target; }
+
+    float getNextValue() noexcept
+    {
+        if (countdown <= 0)
+            return target;
+
+        if (--countdown == 0)
+            current = target;
+        else if (multiplicative)
+            current *= step;
+        else
+            current += step;
+
+        return current;
+    }
+
+    /** Advances the ramp by a number of samples and returns the value it reaches. */
+    float skip (int numSamples) noexcept
+    {
+        if (numSamples >= countdown)
+        {
+            setCurrentAndTarget (target);
+            return current;
+        }
+
+        if (multiplicative)
+            current *= std::pow (step, (float) numSamples);
+        else
+            current += step * (float) numSamples;
+
+        countdown -= numSamples;
+        return current;
+    }
+
+    /** Writes the next numSamples values of the ramp into dest. */
+    void fill (float* dest, int numSamples) noexcept
+    {
+        if (! isSmoothing())
+        {
+            juce::FloatVectorOperations::fill (dest, target, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = getNextValue();
+    }
+
+private:
+    Ramp ramp = Ramp::linear;
+    bool multiplicative = false;
+    float current = 0.0f, target = 0.0f, step = 0.0f;
+    int countdown = 0, rampLength = 1;
+};
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    Fast pitch-to-frequency-ratio conversions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    2^x without calling std::pow or std::exp2.
+
+    The exponent is split into an integer and a fraction in [-0.5, 0.5]; the
+    fraction goes through a degree-5 polynomial for e^(x ln 2), and the integer
+    part is applied with std::ldexp. The relative error is around 3e-6, which is
+    well below 0.01 cents.
+*/
+inline float fastExp2 (float x) noexcept
+{
+    constexpr float ln2 = 0.6931471806f;
+
+    auto whole = std::round (x);
+    auto y = (x - whole) * ln2;
+
+    auto p = 1.0f + y * (1.0f + y * (1.0f / 2.0f + y * (1.0f / 6.0f + y * (1.0f / 24.0f + y * (1.0f / 120.0f)))));
+    return std::ldexp (p, (int) whole);
+}
+
+/** Converts a pitch offset in cents to a frequency ratio. */
+inline float centsToRatio (float cents) noexcept
+{
+    return fastExp2 (cents * (1.0f / 1200.0f));
+}
+
+/** Converts a batch of pitch offsets in cents to frequency ratios. */
+inline void centsToRatios (const float* cents, float* ratios, int num) noexcept
+{
+    for (int i = 0; i < num; ++i)
+        ratios[i] = centsToRatio (cents[i]);
+}
@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    Saves presets to disk, and loads them into the engine without stalling it.
+
+  ==============================================================================
+*/
+
+#include "PresetManager.h"
+
+namespace
+{
+    const juce::Identifier presetType ("SynthPreset");
+    const juce::Identifier versionProperty ("version");
+    const juce::Identifier nameProperty ("name");
+    const juce::Identifier waveformProperty ("waveform");
+    const juce::Identifier filterTypeProperty ("filterType");
+    const juce::Identifier unisonProperty ("unison");
+    const juce::Identifier oscillatorProperty ("oscillator");
+    const juce::Identifier parametersType ("Parameters");
+
+    constexpr int currentVersion = 1;
+
+    // The same names the web UI and render scripts use
+    const char* const waveformNames[] = { "sine", "square", "sawtooth", "triangle" };
+    const char* const filterTypeNames[] = { "lowpass", "highpass", "bandpass", "notch" };
+    const char* const oscillatorNames[] = { "wavetable", "sample" };
+
+    static_assert (std::size (waveformNames) == (size_t) numWaveforms);
+    static_assert (std::size (filterTypeNames) == (size_t) numFilterTypes);
+    static_assert (std::size (oscillatorNames) == (size_t) numOscillatorTypes);
+}
+
+//==============================================================================
+PresetManager::PresetManager (SynthEngine& e, const juce::File& presetDirectory)
+    : engine (e),
+      directory (presetDirectory)
+{
+}
+
+juce::File PresetManager::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("Synth")
+               .getChildFile ("Presets");
+}
+
+juce::File PresetManager::getPresetFile (const juce::String& name) const
+{
+    return directory.getChildFile (juce::File::createLegalFileName (name) + fileExtension);
+}
+
+juce::StringArray PresetManager::getPresetNames() const
+{
+    juce::StringArray names;
+
+    for (const auto& entry : juce::RangedDirectoryIterator (directory, false, juce::String ("*") + fileExtension))
+        names.add (entry.getFile().getFileNameWithoutExtension());
+
+    names.sortNatural();
+    return names;
+}
+
+//==============================================================================
+void PresetManager::loadPreset (const juce::String& name, LoadedCallback onLoaded)
+{
+    loader.addJob ([this, file = getPresetFile (name), onLoaded = std::move (onLoaded)]
+    {
+        juce::MemoryBlock data;
+
+        if (! file.loadFileAsData (data))
+        {
+            DBG ("Couldn't read preset " + file.getFullPathName());
+            return;
+        }
+
+        auto preset = fromValueTree (juce::ValueTree::readFromData (data.getData(), data.getSize()));
+
+        if (preset == nullptr)
+        {
+            DBG ("Not a preset: " + file.getFullPathName());
+            return;
+        }
+
+        // Named after its file, so it matches getPresetNames() even if it was renamed
+        preset->name = file.getFileNameWithoutExtension();
+
+        // The UI gets its own copy; the engine's is never touched again until it's freed
+        auto loaded = *preset;
+        engine.loadPreset (std::move (preset));
+
+        if (onLoaded != nullptr)
+            juce::MessageManager::callAsync ([onLoaded, loaded] { onLoaded (loaded); });
+    });
+}
+
+bool PresetManager::savePreset (const juce::String& name)
+{
+    auto settings = engine.getCurrentSettings();
+    settings.name = name;
+
+    juce::MemoryOutputStream stream;
+    toValueTree (settings).writeToStream (stream);
+
+    // replaceWithData() writes a temporary file and moves it into place, so a failed
+    // save never leaves a half-written preset behind
+    const auto file = getPresetFile (name);
+    file.getParentDirectory().createDirectory();
+
+    if (file.replaceWithData (stream.getData(), stream.getDataSize()))
+        return true;
+
+    DBG ("Couldn't write preset " + file.getFullPathName());
+    return false;
+}
+
+//==============================================================================
+juce::ValueTree PresetManager::toValueTree (const SynthPreset& preset)
+{
+    juce::ValueTree parameters (parametersType);
+
+    for (int i = 0; i < numParameters; ++i)
+        parameters.setProperty (getParameterName ((ParameterID) i), preset.get ((ParameterID) i), nullptr);
+
+    juce::ValueTree tree (presetType);
+    tree.setProperty (versionProperty, currentVersion, nullptr)
+        .setProperty (nameProperty, preset.name, nullptr)
+        .setProperty (waveformProperty, waveformNames[(size_t) preset.waveform], nullptr)
+        .setProperty (filterTypeProperty, filterTypeNames[(size_t) preset.filterType], nullptr)
+        .setProperty (unisonProperty, preset.unisonVoices, nullptr)
+        .setProperty (oscillatorProperty, oscillatorNames[(size_t) preset.oscillator], nullptr);
+
+    tree.appendChild (parameters, nullptr);
+    return tree;
+}
+
+std::unique_ptr<SynthPreset> PresetManager::fromValueTree (const juce::ValueTree& tree)
+{
+    if (! tree.hasType (presetType))
+        return nullptr;
+
+    auto preset = std::make_unique<SynthPreset>();
+    preset->name = tree[nameProperty].toString();
+    preset->waveform = waveformFromString (tree[waveformProperty].toString());
+    preset->filterType = filterTypeFromString (tree[filterTypeProperty].toString());
+    preset->unisonVoices = juce::jlimit (1, VoicePool::maxUnison, (int) tree.getProperty (unisonProperty, 1));
+    preset->oscillator = oscillatorTypeFromString (tree[oscillatorProperty].toString());
+
+    const auto parameters = tree.getChildWithName (parametersType);
+
+    for (int i = 0; i < numParameters; ++i)
+    {
+        const auto id = (ParameterID) i;
+        const auto info = getParameterInfo (id);
+        const auto value = (float) parameters.getProperty (getParameterName (id), info.defaultValue);
+
+        // A hand-edited preset could hold anything, and it goes straight to the audio thread
+        if (std::isfinite (value))
+            preset->set (id, info.clamp (value));
+    }
+
+    return preset;
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Saves presets to disk, and loads them into the engine without stalling it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SynthEngine.h"
+
+//==============================================================================
+/**
+    Keeps a folder of presets, one binary ValueTree file each.
+
+    Files are read, parsed and turned into a SynthPreset on a background thread,
+    which then hands the finished preset to SynthEngine::loadPreset(). The audio
+    thread picks it up at the start of its next block with a single atomic load,
+    so a slow disk or a large folder never costs it anything, and switching presets
+    mid-performance can't cause a dropout. Saving writes one small file, so it's
+    done straight away on the calling thread.
+
+    Presets only store settings that make up the sound (see SynthPreset). Missing
+    values load as their defaults, so older files keep working as parameters are
+    added.
+
+    Call the public methods from the message thread.
+*/
+class PresetManager
+{
+public:
+    /** Called on the message thread once the engine has been given a loaded preset. */
+    using LoadedCallback = std::function<void (const SynthPreset&)>;
+
+    PresetManager (SynthEngine& engine, const juce::File& directory = getDefaultDirectory());
+
+    /** The folder in the user's application data where presets are kept. */
+    static juce::File getDefaultDirectory();
+
+    /** The names of the presets in the folder, sorted. */
+    juce::StringArray getPresetNames() const;
+
+    /** Loads the named preset in the background. If the file is missing or can't be
+        read, the engine is left as it is and onLoaded isn't called.
+    */
+    void loadPreset (const juce::String& name, LoadedCallback onLoaded);
+
+    /** Saves the engine's current settings under the given name, replacing any preset
+        already called that. Returns false if the file couldn't be written.
+    */
+    bool savePreset (const juce::String& name);
+
+    //==============================================================================
+    static juce::ValueTree toValueTree (const SynthPreset& preset);
+
+    /** Returns nullptr if the tree isn't a preset. */
+    static std::unique_ptr<SynthPreset> fromValueTree (const juce::ValueTree& tree);
+
+    static constexpr const char* fileExtension = ".synthpreset";
+
+private:
+    //==============================================================================
+    juce::File getPresetFile (const juce::String& name) const;
+
+    SynthEngine& engine;
+    const juce::File directory;
+
+    // Last, so its jobs have finished before anything they use is destroyed
+    juce::ThreadPool loader { juce::ThreadPoolOptions{}.withThreadName ("Preset loader")
+                                                       .withNumberOfThreads (1) };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetManager)
+};
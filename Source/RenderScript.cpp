@@ -0,0 +1,312 @@
+/*
+  ==============================================================================
+
+    Offline render jobs, read from a JSON note and parameter script.
+
+  ==============================================================================
+*/
+
+#include "RenderScript.h"
+
+namespace
+{
+    /** Reads a property from a job, falling back to the top level of the script, then to a default. */
+    juce::var getSetting (const juce::var& job, const juce::var& script, const juce::Identifier& name,
+                          const juce::var& defaultValue)
+    {
+        if (job.hasProperty (name))
+            return job[name];
+
+        return script.getProperty (name, defaultValue);
+    }
+
+    /** True for a JSON number. A missing value or a string would otherwise read as 0. */
+    bool isNumber (const juce::var& value)
+    {
+        return value.isInt() || value.isInt64() || value.isDouble();
+    }
+
+    juce::Result parseEvent (const juce::var& json, const RenderJob& job, RenderJob::Event& event)
+    {
+        using Type = RenderJob::Event::Type;
+
+        auto type = json["type"].toString();
+        auto time = (double) json.getProperty ("time", 0.0);
+
+        if (time < 0.0)
+            return juce::Result::fail ("event time can't be negative");
+
+        event.sample = (juce::int64) std::llround (time * job.sampleRate);
+
+        if (type == "noteOn" || type == "noteOff")
+        {
+            event.type = type == "noteOn" ? Type::noteOn : Type::noteOff;
+            event.note = json["note"];
+
+            if (! juce::isPositiveAndBelow (event.note, 128))
+                return juce::Result::fail ("note must be a MIDI note number from 0 to 127");
+
+            event.value = (float) json.getProperty ("velocity", 1.0);
+            event.frequency = json.hasProperty ("frequency") ? (double) json["frequency"]
+                                                             : juce::MidiMessage::getMidiNoteInHertz (event.note);
+        }
+        else if (type == "allNotesOff")
+        {
+            event.type = Type::allNotesOff;
+        }
+        else if (type == "parameter")
+        {
+            event.type = Type::parameter;
+            event.parameter = parameterFromName (json["name"].toString());
+            event.value = json["value"];
+
+            if (event.parameter == ParameterID::numParameters)
+                return juce::Result::fail ("unknown parameter \"" + json["name"].toString() + "\"");
+
+            if (! isNumber (json["value"]) || ! std::isfinite (event.value))
+                return juce::Result::fail ("parameter \"" + json["name"].toString() + "\" needs a number");
+
+            event.value = getParameterInfo (event.parameter).clamp (event.value);
+        }
+        else if (type == "waveform")
+        {
+            event.type = Type::waveform;
+            event.value = (float) waveformFromString (json["value"].toString());
+        }
+        else if (type == "filterType")
+        {
+            event.type = Type::filterType;
+            event.value = (float) filterTypeFromString (json["value"].toString());
+        }
+        else if (type == "unison")
+        {
+            event.type = Type::unison;
+            event.value = json["value"];
+        }
+        else if (type == "oscillator")
+        {
+            event.type = Type::oscillator;
+            event.value = (float) oscillatorTypeFromString (json["value"].toString());
+        }
+        else
+        {
+            return juce::Result::fail ("unknown event type \"" + type + "\"");
+        }
+
+        return juce::Result::ok();
+    }
+
+    juce::Result parseJob (const juce::var& json, const juce::var& script, RenderJob& job)
+    {
+        using Type = RenderJob::Event::Type;
+
+        job.output = json["output"].toString();
+        job.name = json.getProperty ("name", job.output).toString();
+        job.sampleRate = getSetting (json, script, "sampleRate", 48000.0);
+        job.blockSize = getSetting (json, script, "blockSize", 512);
+        job.bitDepth = getSetting (json, script, "bitDepth", 24);
+        job.oversampling = getSetting (json, script, "oversampling", RenderJob::defaultOversampling);
+        job.samples = json["samples"].toString();
+        job.impulseResponse = json["impulseResponse"].toString();
+        job.lengthInSamples = (juce::int64) std::llround ((double) json["length"] * job.sampleRate);
+
+        if (job.output.isEmpty())
+            return juce::Result::fail ("missing \"output\"");
+
+        if (job.sampleRate < 8000.0 || job.sampleRate > 768000.0)
+            return juce::Result::fail ("sampleRate must be between 8000 and 768000");
+
+        if (job.blockSize < 1)
+            return juce::Result::fail ("blockSize must be at least 1");
+
+        if (job.oversampling != 1 && job.oversampling != 2 && job.oversampling != 4 && job.oversampling != 8)
+            return juce::Result::fail ("oversampling must be 1, 2, 4 or 8");
+
+        if (job.lengthInSamples <= 0)
+            return juce::Result::fail ("\"length\" must be greater than zero");
+
+        // The starting settings become events on sample 0, ahead of the script's own.
+        // Parameters go first, so render() can apply them before the engine is prepared.
+        const auto addStartEvent = [&job] (Type type, float value, ParameterID parameter = ParameterID::volume)
+        {
+            RenderJob::Event e;
+            e.type = type;
+            e.value = value;
+            e.parameter = parameter;
+            job.events.push_back (e);
+        };
+
+        if (auto* parameters = json["parameters"].getDynamicObject())
+        {
+            for (auto& property : parameters->getProperties())
+            {
+                auto id = parameterFromName (property.name.toString());
+
+                if (id == ParameterID::numParameters)
+                    return juce::Result::fail ("unknown parameter \"" + property.name.toString() + "\"");
+
+                const auto value = (float) property.value;
+
+                if (! isNumber (property.value) || ! std::isfinite (value))
+                    return juce::Result::fail ("parameter \"" + property.name.toString() + "\" needs a number");
+
+                // Kept to the same range as presets, so a script can't push the engine further
+                addStartEvent (Type::parameter, getParameterInfo (id).clamp (value), id);
+            }
+        }
+
+        if (json.hasProperty ("waveform"))
+            addStartEvent (Type::waveform, (float) waveformFromString (json["waveform"].toString()));
+
+        if (json.hasProperty ("filterType"))
+            addStartEvent (Type::filterType, (float) filterTypeFromString (json["filterType"].toString()));
+
+        if (json.hasProperty ("unison"))
+            addStartEvent (Type::unison, (float) json["unison"]);
+
+        if (json.hasProperty ("oscillator"))
+            addStartEvent (Type::oscillator, (float) oscillatorTypeFromString (json["oscillator"].toString()));
+        else if (job.samples.isNotEmpty())
+            addStartEvent (Type::oscillator, (float) OscillatorType::sample);
+
+        if (auto* routes = json["modulation"].getArray())
+        {
+            for (auto& route : *routes)
+            {
+                const auto amount = (float) route["amount"];
+
+                if (! std::isfinite (amount) || std::abs (amount) > 1.0f)
+                    return juce::Result::fail ("modulation amounts must be between -1 and 1");
+
+                job.modulation.push_back ({ modulationSourceFromString (route["source"].toString()),
+                                            modulationDestinationFromString (route["destination"].toString()),
+                                            amount,
+                                            modulationRateFromString (route["rate"].toString()) });
+            }
+        }
+
+        if (auto* events = json["events"].getArray())
+        {
+            for (auto& e : *events)
+            {
+                RenderJob::Event event;
+                auto result = parseEvent (e, job, event);
+
+                if (result.failed())
+                    return result;
+
+                job.events.push_back (event);
+            }
+        }
+
+        std::stable_sort (job.events.begin(), job.events.end(),
+                          [] (const auto& a, const auto& b) { return a.sample < b.sample; });
+
+        return juce::Result::ok();
+    }
+
+    void applyEvent (SynthEngine& engine, const RenderJob::Event& e)
+    {
+        using Type = RenderJob::Event::Type;
+
+        switch (e.type)
+        {
+            case Type::noteOn:       engine.noteOn (e.note, e.frequency, e.value); break;
+            case Type::noteOff:      engine.noteOff (e.note); break;
+            case Type::allNotesOff:  engine.allNotesOff(); break;
+            case Type::parameter:    engine.getParameters().set (e.parameter, e.value); break;
+            case Type::waveform:     engine.setWaveform ((Waveform) (int) e.value); break;
+            case Type::filterType:   engine.setFilterType ((FilterType) (int) e.value); break;
+            case Type::unison:       engine.setUnisonVoices ((int) e.value); break;
+            case Type::oscillator:   engine.setOscillatorType ((OscillatorType) (int) e.value); break;
+        }
+    }
+}
+
+//==============================================================================
+juce::Result RenderScript::parse (const juce::var& script, std::vector<RenderJob>& jobs)
+{
+    auto* jobList = script["jobs"].getArray();
+
+    if (jobList == nullptr)
+        return juce::Result::fail ("the script needs a \"jobs\" array");
+
+    jobs.clear();
+    jobs.reserve ((size_t) jobList->size());
+
+    for (int i = 0; i < jobList->size(); ++i)
+    {
+        RenderJob job;
+        auto result = parseJob (jobList->getReference (i), script, job);
+
+        if (result.failed())
+            return juce::Result::fail ("job " + juce::String (i + 1) + ": " + result.getErrorMessage());
+
+        jobs.push_back (std::move (job));
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+bool RenderJob::render (const std::function<bool (const float* const*, int)>& writeBlock) const
+{
+    auto engine = std::make_unique<SynthEngine>();
+    engine->setEventTiming (SynthEngine::EventTiming::nextBlock);
+    engine->setOversampling (oversampling);
+    engine->setRenderPath (renderPath);
+    engine->setNumRenderThreads (renderThreads);
+
+    if (samples.isNotEmpty())
+    {
+        juce::String error;
+        auto library = SampleLibrary::loadDirectory (sampleFolder, error);
+
+        if (library == nullptr)
+        {
+            DBG ("Couldn't load samples: " + error);
+            return false;
+        }
+
+        engine->setStreamSamplesInBackground (false);
+        engine->loadSamples (std::move (library));
+    }
+
+    // Loaded before prepare(), which finishes loading it, so the reverb starts with it
+    if (impulseResponse.isNotEmpty())
+        engine->loadImpulseResponse (impulseResponseFile);
+
+    if (! modulation.empty())
+        engine->setModulation (ModulationPlan::compile (modulation));
+
+    // Parameters set on the first sample are the starting values, so they shouldn't ramp
+    size_t nextEvent = 0;
+
+    for (; nextEvent < events.size() && events[nextEvent].sample == 0 && events[nextEvent].type == Event::Type::parameter; ++nextEvent)
+        engine->getParameters().set (events[nextEvent].parameter, events[nextEvent].value);
+
+    engine->prepare (sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer (SynthEngine::numOutputChannels, blockSize);
+
+    for (juce::int64 position = 0; position < lengthInSamples;)
+    {
+        while (nextEvent < events.size() && events[nextEvent].sample <= position)
+            applyEvent (*engine, events[nextEvent++]);
+
+        auto end = juce::jmin (lengthInSamples, position + blockSize);
+
+        if (nextEvent < events.size())
+            end = juce::jmin (end, events[nextEvent].sample);
+
+        const auto numSamples = (int) (end - position);
+        engine->process (buffer.getArrayOfWritePointers(), numSamples);
+
+        if (! writeBlock (buffer.getArrayOfReadPointers(), numSamples))
+            return false;
+
+        position = end;
+    }
+
+    return true;
+}
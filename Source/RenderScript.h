@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    Offline render jobs, read from a JSON note and parameter script.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "SynthEngine.h"
+
+//==============================================================================
+/**
+    One render: a length of audio, the settings it starts from, and the events
+    to play into it. Rendering doesn't depend on an audio device or on the wall
+    clock, so it runs as fast as the CPU allows and the same job always produces
+    the same samples.
+*/
+struct RenderJob
+{
+    struct Event
+    {
+        enum class Type
+        {
+            noteOn,         // note, value = velocity, frequency
+            noteOff,        // note
+            allNotesOff,
+            parameter,      // parameter, value
+            waveform,       // value = (int) Waveform
+            filterType,     // value = (int) FilterType
+            unison,         // value = number of unison oscillators
+            oscillator      // value = (int) OscillatorType
+        };
+
+        juce::int64 sample = 0;
+        Type type = Type::noteOn;
+        int note = 0;
+        float value = 0.0f;
+        double frequency = 0.0;
+        ParameterID parameter = ParameterID::volume;
+    };
+
+    /** Renders the whole job into a new engine, handing each block to writeBlock as
+        soon as it's made. Blocks are split at events, so each one lands on its exact
+        sample. Returns false if writeBlock does.
+    */
+    bool render (const std::function<bool (const float* const* channels, int numSamples)>& writeBlock) const;
+
+    juce::String name;
+    juce::String output;        // the file to write, as given in the script
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    int bitDepth = 24;
+    int oversampling = defaultOversampling;     // see SynthEngine::setOversampling()
+    juce::int64 lengthInSamples = 0;
+
+    /** A folder of samples for the sample oscillator, as given in the script, and
+        where it is. Whoever reads the script resolves sampleFolder, as it does the
+        output file.
+    */
+    juce::String samples;
+    juce::File sampleFolder;
+
+    /** The same for an impulse response for the reverb. Without one it uses its built-in room. */
+    juce::String impulseResponse;
+    juce::File impulseResponseFile;
+
+    /** The modulation matrix, compiled for the engine when the render starts. */
+    std::vector<ModulationRoute> modulation;
+
+    /** How the engine renders the voices; see SynthEngine::setRenderPath() and
+        setNumRenderThreads(). Scripts don't set these, as they're not meant to change
+        the sound, but SynthGolden renders each job every way to check that.
+    */
+    SynthEngine::RenderPath renderPath = SynthEngine::RenderPath::simd;
+    int renderThreads = 0;
+
+    /** Offline renders can afford more than the app does live. */
+    static constexpr int defaultOversampling = 4;
+
+    /** Sorted by sample. Events on the same sample keep the order they had in the script. */
+    std::vector<Event> events;
+};
+
+//==============================================================================
+/**
+    Reads render jobs from JSON like this:
+
+    @code
+    {
+        "sampleRate": 48000,
+        "blockSize": 512,
+        "bitDepth": 24,
+        "oversampling": 4,
+        "jobs": [
+            {
+                "output": "pad.wav",
+                "length": 4.0,
+                "waveform": "sawtooth",
+                "filterType": "lowpass",
+                "unison": 7,
+                "samples": "Piano",
+                "impulseResponse": "Hall.wav",
+                "oscillator": "sample",
+                "parameters": { "cutoff": 800, "detune": 20, "lfo1Rate": 3, "reverbMix": 0.3 },
+                "modulation": [
+                    { "source": "lfo1", "destination": "cutoff", "amount": 0.5, "rate": "audio" }
+                ],
+                "events": [
+                    { "time": 0.0, "type": "noteOn", "note": 60, "velocity": 0.8 },
+                    { "time": 1.0, "type": "parameter", "name": "cutoff", "value": 3000 },
+                    { "time": 2.0, "type": "noteOff", "note": 60 }
+                ]
+            }
+        ]
+    }
+    @endcode
+
+    sampleRate, blockSize, bitDepth and oversampling (1, 2, 4 or 8) can be given
+    at the top level, in a job, or both. Times and lengths are in seconds, and
+    parameter values are in the engine's units (see ParameterID), using the names
+    from getParameterName(). They're limited to the ranges in getParameterInfo(),
+    as presets are.
+    Other event types are allNotesOff, waveform, filterType, unison and
+    oscillator ("wavetable" or "sample"). A job that gives a samples folder plays
+    it with the sample oscillator unless it says otherwise; its samples are read
+    as the render needs them, without a streaming thread, so it never underruns.
+    Modulation routes take the names from Modulation.h, and their rate is "block"
+    unless it's given as "audio".
+*/
+struct RenderScript
+{
+    static juce::Result parse (const juce::var& script, std::vector<RenderJob>& jobs);
+};
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    A small pool of threads that help the audio thread render a block.
+
+  ==============================================================================
+*/
+
+#include "RenderWorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && JUCE_MSVC
+ #include <intrin.h>
+#endif
+
+namespace
+{
+    /** Called on each turn of a spin-wait. It tells the CPU the thread is only
+        waiting, so it backs off and leaves the core's execution units to its SMT
+        sibling, which may well be the audio thread.
+    */
+    inline void pauseWhileSpinning() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && JUCE_MSVC
+        __yield();
+       #elif JUCE_ARM
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+}
+
+//==============================================================================
+class RenderWorkerPool::Worker  : public juce::Thread
+{
+public:
+    Worker (RenderWorkerPool& p, int index)
+        : juce::Thread ("Render worker " + juce::String (index + 1)),
+          pool (p)
+    {
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        shutdown.signal();
+        stopThread (1000);
+    }
+
+    void run() override
+    {
+        const auto spinTicks = juce::Time::secondsToHighResolutionTicks (spinMicroseconds * 1.0e-6);
+        auto idleSince = juce::Time::getHighResolutionTicks();
+
+        while (! threadShouldExit())
+        {
+            if (pool.runAvailableTasks())
+            {
+                idleSince = juce::Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (juce::Time::getHighResolutionTicks() - idleSince < spinTicks)
+            {
+                pauseWhileSpinning();
+                continue;
+            }
+
+            // Done spinning, so sleep and look again. Only the destructor signals this;
+            // the audio thread leaves the batch for us to find
+            if (! pool.hasAvailableTask())
+                shutdown.wait ((double) pollMilliseconds);
+        }
+    }
+
+private:
+    RenderWorkerPool& pool;
+    juce::WaitableEvent shutdown;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+RenderWorkerPool::RenderWorkerPool (int numWorkers, int blockSize, double sampleRate)
+{
+    const auto numCpus = juce::SystemStats::getNumCpus();
+    const auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime (blockSize, sampleRate);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto worker = std::make_unique<Worker> (*this, i);
+
+        // Give each worker a core of its own, counting down from the last, as long as
+        // that leaves one spare for the audio thread
+        if (numWorkers < numCpus && numCpus <= 32)
+            worker->setAffinityMask (1u << (numCpus - 1 - i));
+
+        if (! worker->startRealtimeThread (options))
+            worker->startThread (juce::Thread::Priority::highest);
+
+        workers.push_back (std::move (worker));
+    }
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    workers.clear();
+}
+
+//==============================================================================
+void RenderWorkerPool::run (Task task, void* context, int numTasks) noexcept
+{
+    jassert (numTasks <= maxTasks);
+
+    if (workers.empty() || numTasks <= 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            task (context, i);
+
+        return;
+    }
+
+    batchTask.store (task, std::memory_order_relaxed);
+    batchContext.store (context, std::memory_order_relaxed);
+    tasksRemaining.store (numTasks, std::memory_order_relaxed);
+
+    // Publishing the claim word releases the stores above to whoever claims a task
+    claim.store (makeClaim (++generation, numTasks, 0));
+
+    runAvailableTasks();
+
+    // Anything left was claimed by a worker that's already running it
+    while (tasksRemaining.load (std::memory_order_acquire) > 0)
+        pauseWhileSpinning();
+}
+
+bool RenderWorkerPool::runAvailableTasks() noexcept
+{
+    auto ranAny = false;
+    auto word = claim.load (std::memory_order_acquire);
+
+    while (getNextTask (word) < getNumTasks (word))
+    {
+        // These might already belong to a newer batch, but then the word has moved on
+        // and the compare-and-swap below fails
+        const auto task = batchTask.load (std::memory_order_relaxed);
+        auto* const context = batchContext.load (std::memory_order_relaxed);
+
+        if (! claim.compare_exchange_weak (word, word + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        task (context, getNextTask (word));
+        tasksRemaining.fetch_sub (1, std::memory_order_release);
+        ranAny = true;
+
+        word = claim.load (std::memory_order_acquire);
+    }
+
+    return ranAny;
+}
+
+bool RenderWorkerPool::hasAvailableTask() const noexcept
+{
+    const auto word = claim.load();
+    return getNextTask (word) < getNumTasks (word);
+}
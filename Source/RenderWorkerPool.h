@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    A small pool of threads that help the audio thread render a block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    Runs a batch of independent tasks on a few worker threads and the audio thread
+    together, and returns once they have all finished.
+
+    The audio thread publishes a batch by storing it and bumping a generation
+    counter; each thread, including the audio thread itself, then claims task
+    indices with a compare-and-swap on a single word holding the generation, the
+    batch size and the next index, so a worker that wakes up late can never claim a
+    task from a newer batch than the one it read. Nothing allocates, and nothing on
+    the audio thread waits on a lock: it keeps claiming tasks until there are none
+    left, then spins until the ones the workers claimed are done.
+
+    Between batches a worker spins for spinMicroseconds, which covers the gaps
+    between the segments of one audio block, and then sleeps, looking for a new
+    batch every pollMilliseconds. The audio thread never wakes a worker, since
+    signalling one would take a lock the worker shares, so publishing a batch is
+    only atomic stores. Because the audio thread takes tasks itself, a worker that
+    wakes late only means less help, never a missed deadline.
+
+    The workers run at realtime priority and, where the OS allows, each is pinned to
+    its own core.
+*/
+class RenderWorkerPool
+{
+public:
+    /** A task. It's given the context passed to run(), and which of the batch's tasks it is. */
+    using Task = void (*) (void* context, int taskIndex) noexcept;
+
+    /** Starts the workers. The block size and sample rate tell the OS how much time
+        they need in each audio period.
+    */
+    RenderWorkerPool (int numWorkers, int blockSize, double sampleRate);
+    ~RenderWorkerPool();
+
+    int getNumWorkers() const noexcept      { return (int) workers.size(); }
+
+    /** Runs task (context, i) for every i from 0 to numTasks - 1, spread across the
+        workers and the calling thread, and returns when all of them have finished.
+        Only one thread may call this, normally the audio thread. There can be at
+        most maxTasks tasks.
+    */
+    void run (Task task, void* context, int numTasks) noexcept;
+
+    static constexpr int maxTasks = 0xffff;
+
+    /** How long a worker keeps looking for work before going to sleep. */
+    static constexpr int spinMicroseconds = 200;
+
+    /** How often a sleeping worker looks for work. */
+    static constexpr int pollMilliseconds = 1;
+
+private:
+    //==============================================================================
+    class Worker;
+
+    /** Claims and runs tasks from the current batch until there are none left.
+        Returns true if it ran any.
+    */
+    bool runAvailableTasks() noexcept;
+    bool hasAvailableTask() const noexcept;
+
+    // The claim word: the batch's generation in the top 32 bits, then its number of
+    // tasks and the index of the next unclaimed one in 16 bits each
+    static juce::uint64 makeClaim (juce::uint32 generation, int numTasks, int nextTask) noexcept
+    {
+        return ((juce::uint64) generation << 32) | ((juce::uint64) numTasks << 16) | (juce::uint64) nextTask;
+    }
+
+    static int getNumTasks (juce::uint64 word) noexcept     { return (int) ((word >> 16) & 0xffff); }
+    static int getNextTask (juce::uint64 word) noexcept     { return (int) (word & 0xffff); }
+
+    std::atomic<juce::uint64> claim { 0 };
+    std::atomic<Task> batchTask { nullptr };
+    std::atomic<void*> batchContext { nullptr };
+    std::atomic<int> tasksRemaining { 0 };
+    juce::uint32 generation = 0;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderWorkerPool)
+};
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    A multisampled instrument, memory-mapped from disk.
+
+  ==============================================================================
+*/
+
+#include "SampleLibrary.h"
+
+//==============================================================================
+std::unique_ptr<SampleLibrary> SampleLibrary::loadDirectory (const juce::File& folder, juce::String& error)
+{
+    auto library = std::make_unique<SampleLibrary>();
+    library->name = folder.getFileName();
+
+    juce::StringArray problems;
+
+    for (const auto& entry : juce::RangedDirectoryIterator (folder, false, "*.wav;*.aif;*.aiff"))
+    {
+        const auto file = entry.getFile();
+        const auto rootKey = parseRootKey (file.getFileNameWithoutExtension());
+
+        if (rootKey < 0)
+            problems.add (file.getFileName() + ": the name doesn't end in a note");
+        else if (auto result = library->addSample (file, rootKey); result.isNotEmpty())
+            problems.add (file.getFileName() + ": " + result);
+    }
+
+    if (library->zones.empty())
+    {
+        error = problems.isEmpty() ? "No WAV or AIFF samples in " + folder.getFullPathName()
+                                   : problems.joinIntoString ("\n");
+        return nullptr;
+    }
+
+    if (! problems.isEmpty())
+    {
+        DBG ("Skipped some samples:\n" + problems.joinIntoString ("\n"));
+    }
+
+    library->finishLoading();
+    return library;
+}
+
+juce::String SampleLibrary::addSample (const juce::File& file, int rootKey)
+{
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+
+    if (file.hasFileExtension ("wav"))
+        reader.reset (juce::WavAudioFormat().createMemoryMappedReader (file));
+    else if (file.hasFileExtension ("aif;aiff"))
+        reader.reset (juce::AiffAudioFormat().createMemoryMappedReader (file));
+
+    if (reader == nullptr)
+        return "not a WAV or AIFF file that can be memory-mapped";
+
+    // Maps the address range only; pages are read from disk when they're first touched
+    if (! reader->mapEntireFile())
+        return "couldn't be mapped into memory";
+
+    if (reader->lengthInSamples <= 0 || reader->numChannels == 0)
+        return "no audio";
+
+    auto zone = std::make_unique<Zone>();
+    zone->file = file;
+    zone->rootKey = juce::jlimit (0, 127, rootKey);
+    zone->rootFrequency = juce::MidiMessage::getMidiNoteInHertz (zone->rootKey);
+    zone->sampleRate = reader->sampleRate;
+    zone->lengthInFrames = reader->lengthInSamples;
+    zone->numChannels = (int) reader->numChannels;
+
+    const auto headFrames = (int) juce::jmin ((juce::int64) preloadFrames, zone->lengthInFrames);
+    zone->head.setSize (2, headFrames);
+    reader->read (&zone->head, 0, headFrames, 0, true, true);
+
+    if (zone->numChannels == 1)
+        zone->head.copyFrom (1, 0, zone->head, 0, 0, headFrames);
+
+    zone->reader = std::move (reader);
+    zones.push_back (std::move (zone));
+    return {};
+}
+
+void SampleLibrary::finishLoading()
+{
+    std::sort (zones.begin(), zones.end(), [] (const auto& a, const auto& b) { return a->rootKey < b->rootKey; });
+
+    keyMap.fill (nullptr);
+
+    // Each sample covers up to halfway to its neighbours, and the outermost ones the rest of the keyboard
+    for (size_t i = 0; i < zones.size(); ++i)
+    {
+        auto& zone = *zones[i];
+        zone.lowKey = i == 0 ? 0 : (zones[i - 1]->rootKey + zone.rootKey) / 2 + 1;
+        zone.highKey = i + 1 == zones.size() ? 127 : (zone.rootKey + zones[i + 1]->rootKey) / 2;
+
+        for (auto key = zone.lowKey; key <= zone.highKey; ++key)
+            keyMap[(size_t) key] = &zone;
+    }
+}
+
+//==============================================================================
+int SampleLibrary::parseRootKey (const juce::String& fileNameWithoutExtension)
+{
+    // The last word, where words are split by spaces, underscores or dashes (but a
+    // dash straight after a note letter is a negative octave)
+    auto text = fileNameWithoutExtension.trim();
+    auto start = text.length();
+
+    while (start > 0)
+    {
+        const auto c = text[start - 1];
+
+        if (c == ' ' || c == '_' || (c == '-' && ! (start >= 2 && juce::String ("ABCDEFGabcdefg#").containsChar (text[start - 2]))))
+            break;
+
+        --start;
+    }
+
+    const auto word = text.substring (start);
+
+    if (word.isEmpty())
+        return -1;
+
+    if (word.containsOnly ("0123456789"))
+        return juce::isPositiveAndBelow (word.getIntValue(), 128) ? word.getIntValue() : -1;
+
+    const auto letter = juce::String ("C D EF G A B").indexOfChar (juce::CharacterFunctions::toUpperCase (word[0]));
+
+    if (letter < 0)
+        return -1;
+
+    auto semitone = letter;
+    auto index = 1;
+
+    if (word[index] == '#')
+    {
+        ++semitone;
+        ++index;
+    }
+    else if (word[index] == 'b')
+    {
+        --semitone;
+        ++index;
+    }
+
+    const auto octaveText = word.substring (index);
+    const auto octaveDigits = octaveText.trimCharactersAtStart ("-");
+
+    if (octaveDigits.isEmpty() || ! octaveDigits.containsOnly ("0123456789"))
+        return -1;
+
+    // Middle C, MIDI note 60, is C4
+    const auto key = (octaveText.getIntValue() + 1) * 12 + semitone;
+    return juce::isPositiveAndBelow (key, 128) ? key : -1;
+}
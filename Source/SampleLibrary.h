@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    A multisampled instrument, memory-mapped from disk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+//==============================================================================
+/**
+    A set of samples, each played across a range of keys around the note it was
+    recorded at.
+
+    Only the first preloadFrames of each sample are read into memory. The rest
+    stays in its file, which is memory-mapped but not read, so a library costs
+    address space rather than RAM until it's played; a SampleStreamer reads the
+    rest on demand. Only WAV and AIFF files can be mapped.
+
+    A library is built on a background thread and never changes once it's handed
+    to the engine, so the audio thread can read it without locking. Several engines
+    can share one, each streaming from it on its own thread: the memory-mapped
+    readers only copy out of the mapping, so they can be read from concurrently.
+*/
+class SampleLibrary
+{
+public:
+    /** One sample, and the keys it plays. */
+    struct Zone
+    {
+        juce::File file;
+        int rootKey = 60, lowKey = 0, highKey = 127;
+        double rootFrequency = 261.63;      // of rootKey, in Hz
+        double sampleRate = 44100.0;
+        juce::int64 lengthInFrames = 0;
+        int numChannels = 2;
+
+        /** The first preloadFrames frames (or fewer, for a shorter sample), as a stereo
+            pair. A mono sample is copied into both channels.
+        */
+        juce::AudioBuffer<float> head;
+
+        /** The whole file, mapped into memory. Only the streamer reads from it. */
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+    };
+
+    /** How much of each sample is kept in memory: enough to play while the streamer
+        catches up with a new note, at any pitch the renderer allows.
+    */
+    static constexpr int preloadFrames = 32768;
+
+    SampleLibrary() = default;
+
+    /** Loads every WAV and AIFF file in a folder whose name ends in the note it was
+        recorded at, as a MIDI note number or a note name with middle C as C4: for
+        example "Piano 60.wav", "Piano C4.wav" or "Piano F#3.aif". Each sample plays
+        the keys closer to its note than to any other sample's.
+
+        Returns nullptr, with a description in error, if no samples could be loaded.
+    */
+    static std::unique_ptr<SampleLibrary> loadDirectory (const juce::File& folder, juce::String& error);
+
+    /** Maps a file and reads its head. Returns an error message, or an empty string.
+        Call finishLoading() after adding the last one.
+    */
+    juce::String addSample (const juce::File& file, int rootKey);
+
+    /** Works out which keys each sample plays. */
+    void finishLoading();
+
+    /** Returns nullptr if no sample covers the key. */
+    const Zone* getZoneForKey (int key) const noexcept
+    {
+        return juce::isPositiveAndBelow (key, (int) keyMap.size()) ? keyMap[(size_t) key] : nullptr;
+    }
+
+    int getNumZones() const noexcept                    { return (int) zones.size(); }
+    const Zone& getZone (int index) const noexcept      { return *zones[(size_t) index]; }
+
+    /** The name of the folder it was loaded from. */
+    juce::String getName() const                        { return name; }
+
+    /** Reads a trailing note from a file name, such as the "C4" in "Piano C4". Returns -1 if there isn't one. */
+    static int parseRootKey (const juce::String& fileNameWithoutExtension);
+
+private:
+    //==============================================================================
+    juce::String name;
+    std::vector<std::unique_ptr<Zone>> zones;
+    std::array<const Zone*, 128> keyMap {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleLibrary)
+};
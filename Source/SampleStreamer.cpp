@@ -0,0 +1,295 @@
+/*
+  ==============================================================================
+
+    Streams sample data from disk to the voices that are playing it.
+
+  ==============================================================================
+*/
+
+#include "SampleStreamer.h"
+
+namespace
+{
+    /** The most the streaming thread reads from a file at once. */
+    constexpr int readChunkFrames = 4096;
+
+    /** Smaller top-ups than this wait for the next pass, unless they finish the sample. */
+    constexpr int minimumReadFrames = 1024;
+}
+
+OscillatorType oscillatorTypeFromString (const juce::String& name)
+{
+    return name == "sample" ? OscillatorType::sample : OscillatorType::wavetable;
+}
+
+//==============================================================================
+SampleStreamer::SampleStreamer()
+    : juce::Thread ("Sample streamer")
+{
+}
+
+SampleStreamer::~SampleStreamer()
+{
+    stopThread (1000);
+}
+
+void SampleStreamer::setLibrary (std::shared_ptr<const SampleLibrary> library)
+{
+    jassert (library != nullptr);
+
+    {
+        const juce::ScopedLock sl (libraryLock);
+
+        // The rings are only needed once there's something to play, and the audio thread
+        // doesn't touch them until it has picked up a library published after this
+        if (readBuffer.getNumSamples() == 0)
+        {
+            for (auto& ring : rings)
+                ring.buffer.setSize (2, ringFrames);
+
+            readBuffer.setSize (2, readChunkFrames);
+        }
+
+        auto* published = library.get();
+        libraries.push_back (std::move (library));
+        pendingLibrary.store (published, std::memory_order_release);
+    }
+
+    if (realtime.load() && ! isThreadRunning())
+        startThread (juce::Thread::Priority::high);
+}
+
+void SampleStreamer::setRealtime (bool shouldStreamInBackground)
+{
+    realtime.store (shouldStreamInBackground);
+
+    if (! shouldStreamInBackground)
+        stopThread (1000);
+    else if (pendingLibrary.load() != nullptr && ! isThreadRunning())
+        startThread (juce::Thread::Priority::high);
+}
+
+//==============================================================================
+void SampleStreamer::beginBlock() noexcept
+{
+    for (int v = 0; v < (int) voices.size(); ++v)
+        if (voices[(size_t) v].stopPending)
+            stopVoice (v);
+
+    if (previousLibrary != nullptr && ! isLibraryInUse (previousLibrary))
+        previousLibrary = nullptr;
+
+    // Only two libraries at a time: a newer one waits until the oldest has gone quiet
+    if (auto* pending = pendingLibrary.load (std::memory_order_acquire); pending != currentLibrary && previousLibrary == nullptr)
+    {
+        previousLibrary = isLibraryInUse (currentLibrary) ? currentLibrary : nullptr;
+        currentLibrary = pending;
+    }
+
+    oldestLibraryInUse.store (previousLibrary != nullptr ? previousLibrary : currentLibrary, std::memory_order_release);
+}
+
+void SampleStreamer::serviceIfOffline()
+{
+    if (! realtime.load (std::memory_order_relaxed))
+        service();
+}
+
+bool SampleStreamer::startVoice (int voice, int key) noexcept
+{
+    auto& v = voices[(size_t) voice];
+    auto* zone = currentLibrary != nullptr ? currentLibrary->getZoneForKey (key) : nullptr;
+
+    if (zone == nullptr)
+    {
+        stopVoice (voice);
+        return false;
+    }
+
+    ++v.generation;
+
+    if (! requests.push ({ voice, v.generation, zone }))
+    {
+        // Whatever the voice streamed before may still be streaming, so keep its library
+        // alive until a stop request gets through
+        v.zone = nullptr;
+        v.stopPending = v.library != nullptr;
+        return false;
+    }
+
+    v.zone = zone;
+    v.library = currentLibrary;
+    v.stopPending = false;
+    v.nextFrame = 0;
+    v.incrementScale = (float) (zone->sampleRate / zone->rootFrequency);
+    v.position = 0.0f;
+
+    float left[2], right[2];
+    readFrames (voice, left, right, 2);
+    v.held[0] = left[0];
+    v.held[1] = right[0];
+    v.next[0] = left[1];
+    v.next[1] = right[1];
+    return true;
+}
+
+void SampleStreamer::stopVoice (int voice) noexcept
+{
+    auto& v = voices[(size_t) voice];
+    v.zone = nullptr;
+
+    if (v.library == nullptr)
+        return;
+
+    ++v.generation;
+    v.stopPending = ! requests.push ({ voice, v.generation, nullptr });
+
+    if (! v.stopPending)
+        v.library = nullptr;
+}
+
+void SampleStreamer::readFrames (int voice, float* left, float* right, int numFrames) noexcept
+{
+    auto& v = voices[(size_t) voice];
+    auto done = 0;
+
+    if (v.zone != nullptr)
+    {
+        const auto& head = v.zone->head;
+
+        if (v.nextFrame < head.getNumSamples())
+        {
+            const auto n = juce::jmin (numFrames, head.getNumSamples() - (int) v.nextFrame);
+            juce::FloatVectorOperations::copy (left, head.getReadPointer (0, (int) v.nextFrame), n);
+            juce::FloatVectorOperations::copy (right, head.getReadPointer (1, (int) v.nextFrame), n);
+            v.nextFrame += n;
+            done = n;
+        }
+
+        if (const auto wanted = (int) juce::jmin ((juce::int64) (numFrames - done), v.zone->lengthInFrames - v.nextFrame); wanted > 0)
+        {
+            auto& ring = rings[(size_t) voice];
+            auto got = 0;
+
+            if (ring.readyGeneration.load (std::memory_order_acquire) == v.generation)
+            {
+                const auto scope = ring.fifo.read (wanted);
+
+                auto copy = [&] (int start, int n)
+                {
+                    juce::FloatVectorOperations::copy (left + done + got, ring.buffer.getReadPointer (0, start), n);
+                    juce::FloatVectorOperations::copy (right + done + got, ring.buffer.getReadPointer (1, start), n);
+                    got += n;
+                };
+
+                if (scope.blockSize1 > 0)   copy (scope.startIndex1, scope.blockSize1);
+                if (scope.blockSize2 > 0)   copy (scope.startIndex2, scope.blockSize2);
+            }
+
+            if (got < wanted)
+                underruns.fetch_add (1, std::memory_order_relaxed);
+
+            v.nextFrame += got;
+            done += got;
+        }
+    }
+
+    if (done < numFrames)
+    {
+        juce::FloatVectorOperations::clear (left + done, numFrames - done);
+        juce::FloatVectorOperations::clear (right + done, numFrames - done);
+    }
+}
+
+bool SampleStreamer::isLibraryInUse (const SampleLibrary* library) const noexcept
+{
+    if (library == nullptr)
+        return false;
+
+    for (const auto& v : voices)
+        if (v.library == library)
+            return true;
+
+    return false;
+}
+
+//==============================================================================
+void SampleStreamer::run()
+{
+    while (! threadShouldExit())
+    {
+        service();
+        wait (serviceIntervalMs);
+    }
+}
+
+void SampleStreamer::service()
+{
+    // Read this first: every request the audio thread made before publishing it is then
+    // in the queue, so once they're handled nothing refers to the older libraries
+    auto* oldestInUse = oldestLibraryInUse.load (std::memory_order_acquire);
+
+    for (Request request; requests.pop (request);)
+    {
+        auto& stream = streams[(size_t) request.voice];
+        stream.zone = request.zone;
+
+        if (stream.zone != nullptr)
+        {
+            // The voice stopped reading the ring when it sent the request, so it can be reset
+            auto& ring = rings[(size_t) request.voice];
+            ring.fifo.reset();
+            stream.position = stream.zone->head.getNumSamples();
+            ring.readyGeneration.store (request.generation, std::memory_order_release);
+        }
+    }
+
+    for (int voice = 0; voice < (int) streams.size(); ++voice)
+        if (streams[(size_t) voice].zone != nullptr)
+            fillRing (voice);
+
+    if (oldestInUse != nullptr)
+    {
+        const juce::ScopedLock sl (libraryLock);
+
+        auto oldest = std::find_if (libraries.begin(), libraries.end(),
+                                    [oldestInUse] (const auto& l) { return l.get() == oldestInUse; });
+
+        if (oldest != libraries.end())
+            libraries.erase (libraries.begin(), oldest);
+    }
+}
+
+void SampleStreamer::fillRing (int voice)
+{
+    auto& stream = streams[(size_t) voice];
+    auto& ring = rings[(size_t) voice];
+
+    for (;;)
+    {
+        const auto remaining = stream.zone->lengthInFrames - stream.position;
+        const auto n = (int) juce::jmin ((juce::int64) juce::jmin (ring.fifo.getFreeSpace(), readChunkFrames), remaining);
+
+        if (n <= 0 || (n < minimumReadFrames && n < remaining))
+            return;
+
+        // This is where the file's pages are touched, and may have to come from disk
+        stream.zone->reader->read (&readBuffer, 0, n, stream.position, true, true);
+
+        if (stream.zone->numChannels == 1)
+            readBuffer.copyFrom (1, 0, readBuffer, 0, 0, n);
+
+        const auto scope = ring.fifo.write (n);
+
+        auto copy = [&] (int start, int size, int offset)
+        {
+            ring.buffer.copyFrom (0, start, readBuffer, 0, offset, size);
+            ring.buffer.copyFrom (1, start, readBuffer, 1, offset, size);
+        };
+
+        if (scope.blockSize1 > 0)   copy (scope.startIndex1, scope.blockSize1, 0);
+        if (scope.blockSize2 > 0)   copy (scope.startIndex2, scope.blockSize2, scope.blockSize1);
+
+        stream.position += n;
+    }
+}
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    Streams sample data from disk to the voices that are playing it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LockFreeFifo.h"
+#include "SampleLibrary.h"
+#include "VoicePool.h"
+
+//==============================================================================
+/** What the voices play: the wavetables, or the samples in a SampleLibrary. */
+enum class OscillatorType
+{
+    wavetable = 0,
+    sample
+};
+
+static constexpr int numOscillatorTypes = 2;
+
+/** Converts "wavetable" or "sample" to an OscillatorType. Unknown names fall back to wavetable. */
+OscillatorType oscillatorTypeFromString (const juce::String& name);
+
+//==============================================================================
+/**
+    Feeds each voice that's playing a sample from a SampleLibrary.
+
+    A voice starts on the sample's preloaded head, so a note can begin the moment
+    it's played. Meanwhile a background thread reads the rest of the sample from its
+    memory-mapped file into a lock-free ring buffer that belongs to the voice, and
+    the voice carries on from there once the head runs out. Page faults and disk
+    reads only ever happen on the streaming thread. The audio thread talks to it
+    through a LockFreeFifo of start and stop requests; each one carries a
+    generation number, so the audio thread never reads ring data meant for a note
+    the voice has since stopped playing.
+
+    setLibrary() can be called while notes are playing. The audio thread switches
+    to the new library at the start of a block, once no voice is still playing a
+    sample from the library before the current one, and the streaming thread frees
+    each library once the audio thread has finished with it. Nothing on the audio
+    thread locks, allocates or frees.
+
+    Offline renderers, which run faster than real time, call setRealtime (false):
+    then there's no background thread, and the rendering thread fills the ring
+    buffers itself before each segment, so a render never underruns.
+*/
+class SampleStreamer  : private juce::Thread
+{
+public:
+    SampleStreamer();
+    ~SampleStreamer() override;
+
+    /** How many frames each voice's ring buffer holds. */
+    static constexpr int ringFrames = 16384;
+
+    /** The most frames a voice may advance by per rendered sample: three octaves
+        above the sample's own pitch at its own rate.
+    */
+    static constexpr int maxIncrement = 8;
+
+    /** How often the streaming thread tops up the ring buffers. */
+    static constexpr int serviceIntervalMs = 2;
+
+    //==============================================================================
+    /** Hands over a library for the voices to play from. Call from any thread but the
+        audio thread. Several streamers can share one library.
+    */
+    void setLibrary (std::shared_ptr<const SampleLibrary> library);
+
+    /** Whether the ring buffers are filled by a background thread, the default, or by
+        the rendering thread. Call before rendering starts.
+    */
+    void setRealtime (bool shouldStreamInBackground);
+
+    //==============================================================================
+    /** The playback state of one voice. Only touched by the thread rendering it. */
+    struct Voice
+    {
+        const SampleLibrary::Zone* zone = nullptr;      // nullptr if it isn't playing a sample
+        const SampleLibrary* library = nullptr;         // the zone's library, or one still being streamed from
+        juce::uint32 generation = 0;
+        juce::int64 nextFrame = 0;                      // the next frame readFrames() will return
+        float incrementScale = 1.0f;                    // converts VoicePool::increment to frames per sample
+        float position = 0.0f;                          // how far playback is from held towards next
+        float held[2] {}, next[2] {};                   // the two frames either side of the playback position
+        bool stopPending = false;                       // the stop request didn't fit in the queue
+    };
+
+    /** Call at the start of each block, on the audio thread. Switches to a new
+        library if one is waiting and the old one is finished with.
+    */
+    void beginBlock() noexcept;
+
+    /** In offline mode, tops up every voice's ring buffer; otherwise does nothing.
+        Call on the audio thread before rendering each segment.
+    */
+    void serviceIfOffline();
+
+    /** Starts a voice on the sample for a key, from the library the audio thread is
+        using. Returns false, leaving the voice silent, if no sample covers the key.
+    */
+    bool startVoice (int voice, int key) noexcept;
+
+    /** Stops a voice's stream, once it's finished or been taken for a wavetable note. */
+    void stopVoice (int voice) noexcept;
+
+    Voice& getVoice (int voice) noexcept                { return voices[(size_t) voice]; }
+
+    /** Copies a voice's next frames into left and right, first from the preloaded head
+        and then from its ring buffer. Frames past the end of the sample, or that the
+        streaming thread hasn't delivered yet, come out as silence.
+    */
+    void readFrames (int voice, float* left, float* right, int numFrames) noexcept;
+
+    /** True once every frame of a voice's sample has been read. */
+    bool hasFinished (int voice) const noexcept
+    {
+        const auto& v = voices[(size_t) voice];
+        return v.zone != nullptr && v.nextFrame >= v.zone->lengthInFrames;
+    }
+
+    /** How many times a voice needed frames the streaming thread hadn't delivered yet. */
+    juce::uint64 getNumUnderruns() const noexcept       { return underruns.load (std::memory_order_relaxed); }
+
+private:
+    //==============================================================================
+    struct Request
+    {
+        int voice = 0;
+        juce::uint32 generation = 0;
+        const SampleLibrary::Zone* zone = nullptr;      // nullptr to stop
+    };
+
+    /** Written by the streaming thread and read by the voice. */
+    struct Ring
+    {
+        juce::AudioBuffer<float> buffer;
+        juce::AbstractFifo fifo { ringFrames };
+        std::atomic<juce::uint32> readyGeneration { 0 };    // the note the contents belong to
+    };
+
+    /** Where the streaming thread has got to in a voice's sample. */
+    struct Stream
+    {
+        const SampleLibrary::Zone* zone = nullptr;
+        juce::int64 position = 0;
+    };
+
+    void run() override;
+    void service();
+    void fillRing (int voice);
+    bool isLibraryInUse (const SampleLibrary*) const noexcept;
+
+    // Only touched by the audio thread
+    std::array<Voice, VoicePool::maxVoices> voices;
+    const SampleLibrary* currentLibrary = nullptr;
+    const SampleLibrary* previousLibrary = nullptr;         // still playing, so the switch to currentLibrary waits
+
+    // Only touched by whichever thread fills the rings
+    std::array<Stream, VoicePool::maxVoices> streams;
+    juce::AudioBuffer<float> readBuffer;
+
+    std::array<Ring, VoicePool::maxVoices> rings;
+    LockFreeFifo<Request> requests { 1024 };
+
+    // The newest library handed over, and the oldest the audio thread still uses
+    std::atomic<const SampleLibrary*> pendingLibrary { nullptr }, oldestLibraryInUse { nullptr };
+    juce::CriticalSection libraryLock;                      // never taken by the audio thread
+    std::vector<std::shared_ptr<const SampleLibrary>> libraries;    // oldest first
+
+    std::atomic<bool> realtime { true };
+    std::atomic<juce::uint64> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleStreamer)
+};
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    Hands immutable snapshots to the audio thread without locking it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    Publishes immutable objects, such as presets, from control threads to the
+    audio thread, and frees them once the audio thread has moved past them.
+
+    publish() keeps each snapshot before publishing it through an atomic pointer,
+    so it's never freed while the audio thread can see it. The audio thread reads
+    getLatest(), switches to it, and says so with markApplied(); from then on it
+    only ever reads that snapshot or a newer one, so releaseRetired() can free the
+    older ones. The lock is only taken by the control threads.
+*/
+template <typename Type>
+class SnapshotList
+{
+public:
+    SnapshotList() = default;
+
+    /** Call from any thread but the audio thread. */
+    void publish (std::unique_ptr<const Type> snapshot)
+    {
+        jassert (snapshot != nullptr);
+
+        const juce::ScopedLock sl (lock);
+
+        auto* published = snapshot.get();
+        retained.push_back (std::move (snapshot));
+        latest.store (published, std::memory_order_release);
+
+        releaseRetired();
+    }
+
+    /** The newest snapshot published, or nullptr. Called by the audio thread. */
+    const Type* getLatest() const noexcept                  { return latest.load (std::memory_order_acquire); }
+
+    /** Called by the audio thread once it has switched to a snapshot. */
+    void markApplied (const Type* snapshot) noexcept        { applied.store (snapshot, std::memory_order_release); }
+
+    /** Frees everything older than the snapshot the audio thread last switched to.
+        Call from any thread but the audio thread.
+    */
+    void releaseRetired()
+    {
+        const juce::ScopedLock sl (lock);
+
+        auto* newestApplied = applied.load (std::memory_order_acquire);
+        auto found = std::find_if (retained.begin(), retained.end(),
+                                   [newestApplied] (const auto& s) { return s.get() == newestApplied; });
+
+        if (found != retained.end())
+            retained.erase (retained.begin(), found);
+    }
+
+private:
+    std::atomic<const Type*> latest { nullptr }, applied { nullptr };
+    juce::CriticalSection lock;
+    std::vector<std::unique_ptr<const Type>> retained;     // oldest first
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SnapshotList)
+};
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    Topology-preserving-transform state variable filter coefficients.
+
+  ==============================================================================
+*/
+
+#include "StateVariableFilter.h"
+
+//==============================================================================
+FilterType filterTypeFromString (const juce::String& name)
+{
+    if (name == "highpass")  return FilterType::highpass;
+    if (name == "bandpass")  return FilterType::bandpass;
+    if (name == "notch")     return FilterType::notch;
+
+    return FilterType::lowpass;
+}
+
+//==============================================================================
+SVFCoefficients SVFCoefficients::make (float g, float resonance, FilterType type) noexcept
+{
+    // k = 1 / Q: 2 is a flat response, and it approaches 0 as the filter starts to ring
+    auto k = 2.0f - 1.95f * juce::jlimit (0.0f, 1.0f, resonance);
+
+    SVFCoefficients c;
+    c.a1 = 1.0f / (1.0f + g * (g + k));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+
+    switch (type)
+    {
+        case FilterType::lowpass:   c.m0 = 0.0f; c.m1 = 0.0f; c.m2 = 1.0f;  break;
+        case FilterType::bandpass:  c.m0 = 0.0f; c.m1 = 1.0f; c.m2 = 0.0f;  break;
+        case FilterType::highpass:  c.m0 = 1.0f; c.m1 = -k;   c.m2 = -1.0f; break;
+        case FilterType::notch:     c.m0 = 1.0f; c.m1 = -k;   c.m2 = 0.0f;  break;
+    }
+
+    return c;
+}
+
+//==============================================================================
+void FilterCoefficientTable::build()
+{
+    if (isBuilt())
+        return;
+
+    table.malloc ((size_t) tableSize);
+
+    for (int i = 0; i < tableSize; ++i)
+    {
+        auto normalisedCutoff = (double) maxNormalisedCutoff * i / (tableSize - 1);
+        table[i] = (float) std::tan (juce::MathConstants<double>::pi * normalisedCutoff);
+    }
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    Topology-preserving-transform state variable filter coefficients.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/** The responses the voice filter can produce. */
+enum class FilterType
+{
+    lowpass = 0,
+    highpass,
+    bandpass,
+    notch
+};
+
+static constexpr int numFilterTypes = 4;
+
+/** Converts the filter names used by the web UI ("lowpass", "highpass", "bandpass",
+    "notch") to a FilterType. Unknown names fall back to lowpass.
+*/
+FilterType filterTypeFromString (const juce::String& name);
+
+//==============================================================================
+/**
+    Coefficients for one TPT state variable filter (Zavalishin's form).
+
+    The filter's three outputs are mixed as m0 * input + m1 * band + m2 * low,
+    which covers every FilterType without a branch in the per-sample loop:
+
+        v3 = input - s2
+        v1 = a1 * s1 + a2 * v3          (band)
+        v2 = s2 + a2 * s1 + a3 * v3     (low)
+        s1 = 2 * v1 - s1
+        s2 = 2 * v2 - s2
+*/
+struct SVFCoefficients
+{
+    float a1 = 1.0f, a2 = 0.0f, a3 = 0.0f;
+    float m0 = 0.0f, m1 = 0.0f, m2 = 1.0f;
+
+    /** Makes coefficients from the prewarped gain g = tan (pi * cutoff / sampleRate)
+        and a resonance between 0 (no peak) and 1 (self-oscillation).
+    */
+    static SVFCoefficients make (float g, float resonance, FilterType type) noexcept;
+};
+
+//==============================================================================
+/**
+    A lookup table for the filter's prewarp, tan (pi * cutoff / sampleRate).
+
+    Calling std::tan whenever the cutoff moves is what makes per-voice filters
+    expensive, so the table covers normalised cutoffs from 0 to maxNormalisedCutoff
+    and is read with linear interpolation. It doesn't depend on the sample rate,
+    so it only needs building once.
+*/
+class FilterCoefficientTable
+{
+public:
+    static constexpr int tableSize = 4096;
+    static constexpr float maxNormalisedCutoff = 0.49f;
+
+    FilterCoefficientTable() = default;
+
+    /** Fills the table. Does nothing if it's already been built. Allocates. */
+    void build();
+
+    bool isBuilt() const noexcept       { return table != nullptr; }
+
+    /** Returns tan (pi * normalisedCutoff), where normalisedCutoff = cutoff / sampleRate. */
+    float getPrewarpedGain (float normalisedCutoff) const noexcept
+    {
+        jassert (isBuilt());
+
+        auto position = juce::jlimit (0.0f, 1.0f, normalisedCutoff / maxNormalisedCutoff) * (float) (tableSize - 1);
+        auto index = juce::jmin ((int) position, tableSize - 2);
+        auto frac = position - (float) index;
+
+        return table[index] + frac * (table[index + 1] - table[index]);
+    }
+
+private:
+    juce::HeapBlock<float> table;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterCoefficientTable)
+};
@@ -0,0 +1,982 @@
+/*
+  ==============================================================================
+
+    The polyphonic synth engine, independent of any UI.
+
+  ==============================================================================
+*/
+
+#include "SynthEngine.h"
+
+namespace
+{
+    /** The shortest attack and release, so notes never start or stop with a click. */
+    constexpr double minimumEnvelopeSeconds = 0.001;
+
+    /** How long parameter changes take to reach their new value. */
+    constexpr double smoothingSeconds = 0.02;
+
+    /** The MIDI controllers the engine acts on itself. */
+    constexpr int sustainPedalController = 64;
+    constexpr int allSoundOffController = 120;
+    constexpr int resetAllControllersController = 121;
+    constexpr int allNotesOffController = 123;
+
+    /** Device blocks shorter than this are rendered on the audio thread alone, as the
+        workers would spend about as long waking up as rendering.
+    */
+    constexpr int minParallelBlockSize = 64;
+
+    /** Nor are segments cut shorter than this by events. */
+    constexpr int minParallelSegmentSize = 8;
+
+    /** The least work, in voices times unison oscillators, worth handing to another thread. */
+    constexpr int minOscillatorsPerTask = 32;
+
+    /** The longest segment of voice rendering, in samples at the highest oversampling. */
+    constexpr int maxVoiceSegmentSize = SynthEngine::controlBlockSize * SynthEngine::maxOversampling;
+
+    static_assert (maxVoiceSegmentSize <= AudioRateModulation::maxSamples);
+
+    /** The MIDI controller that ModulationSource::modWheel follows. */
+    constexpr int modWheelController = 1;
+
+    /** The LFOs' shapes, from a phase in [0, 1). */
+    float lfoSine (double phase) noexcept
+    {
+        return (float) std::sin (phase * juce::MathConstants<double>::twoPi);
+    }
+
+    float lfoTriangle (double phase) noexcept
+    {
+        return (float) (1.0 - 4.0 * std::abs (phase - 0.5));
+    }
+}
+
+//==============================================================================
+SynthEngine::SynthEngine()
+{
+    renderSettings.wavetables = &tables->wavetables;
+    renderSettings.samples = &sampleStreamer;
+    voicePitchModulation.fill (1.0f);
+}
+
+void SynthEngine::prepare (double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    voiceSampleRate = sampleRate * oversamplingFactor;
+
+    filterCutoff = filterResonance = unisonSpread = -1.0f;
+
+    // Channels 0 and 1 are the left and right voice mix, channel 2 the per-sample volume ramp
+    mixBuffer.setSize (3, maximumBlockSize);
+    effects.prepare (sampleRate, maximumBlockSize);
+
+    // The workers are told the block length, so they're restarted whenever it changes
+    renderWorkers.reset();
+
+    if (numRenderThreads > 0)
+        renderWorkers = std::make_unique<RenderWorkerPool> (numRenderThreads, maximumBlockSize, sampleRate);
+
+    partialMixes.assign ((size_t) (2 * numRenderThreads * maxVoiceSegmentSize), 0.0f);
+
+    // Voices are rendered a segment at a time, so that's the most each one processes
+    for (size_t i = 0; i < oversamplers.size(); ++i)
+    {
+        oversamplers[i] = std::make_unique<juce::dsp::Oversampling<float>> (2, i + 1,
+                                                                             juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+        oversamplers[i]->initProcessing ((size_t) controlBlockSize);
+    }
+
+    oversampler = getOversampler (oversamplingFactor);
+
+    for (int i = 0; i < numParameters; ++i)
+    {
+        auto id = (ParameterID) i;
+        smoothers[(size_t) i].prepare (sampleRate, smoothingSeconds, getParameterInfo (id).ramp);
+        smoothers[(size_t) i].setCurrentAndTarget (parameters.get (id));
+    }
+
+    // Voices keep their frequency, so recompute their increments for the new rate
+    for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+        setVoiceFrequency (v, voices.frequency[v]);
+    }
+}
+
+//==============================================================================
+bool SynthEngine::noteOn (int key, double frequencyHz, float velocity)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::noteOn;
+    e.key = key;
+    e.value = velocity;
+    e.frequency = frequencyHz;
+    return postEvent (e);
+}
+
+bool SynthEngine::noteOff (int key)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::noteOff;
+    e.key = key;
+    return postEvent (e);
+}
+
+bool SynthEngine::allNotesOff()
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::allNotesOff;
+    return postEvent (e);
+}
+
+bool SynthEngine::setWaveform (Waveform newWaveform)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::waveform;
+    e.value = (float) newWaveform;
+    return postEvent (e);
+}
+
+bool SynthEngine::setFilterType (FilterType newType)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::filterType;
+    e.value = (float) newType;
+    return postEvent (e);
+}
+
+bool SynthEngine::setUnisonVoices (int numVoices)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::unisonVoices;
+    e.value = (float) numVoices;
+    return postEvent (e);
+}
+
+bool SynthEngine::setOscillatorType (OscillatorType newType)
+{
+    SynthEvent e;
+    e.type = SynthEvent::Type::oscillator;
+    e.value = (float) newType;
+    return postEvent (e);
+}
+
+bool SynthEngine::postMidiMessage (const juce::MidiMessage& message)
+{
+    SynthEvent e;
+
+    if (message.isNoteOn())
+    {
+        e.type = SynthEvent::Type::noteOn;
+        e.key = message.getNoteNumber();
+        e.value = message.getFloatVelocity();
+        e.frequency = juce::MidiMessage::getMidiNoteInHertz (e.key);
+    }
+    else if (message.isNoteOff())
+    {
+        e.type = SynthEvent::Type::noteOff;
+        e.key = message.getNoteNumber();
+    }
+    else if (message.isPitchWheel())
+    {
+        e.type = SynthEvent::Type::pitchBend;
+        e.value = juce::jlimit (-1.0f, 1.0f, (float) (message.getPitchWheelValue() - 8192) / 8192.0f);
+    }
+    else if (message.isController())
+    {
+        e.type = SynthEvent::Type::controller;
+        e.key = message.getControllerNumber();
+        e.value = (float) message.getControllerValue() / 127.0f;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (eventTiming.load (std::memory_order_relaxed) == EventTiming::timestamped)
+    {
+        // The timestamp is when the message arrived, on a different clock to ours. Carry
+        // its age across, so a MIDI thread that runs late doesn't make the note late too
+        const auto now = getCurrentTimeNs();
+        const auto ageSeconds = message.getTimeStamp() > 0.0
+                                  ? juce::Time::getMillisecondCounterHiRes() * 0.001 - message.getTimeStamp()
+                                  : 0.0;
+
+        e.timeNs = now - juce::jmin (now, (uint64_t) (juce::jmax (0.0, ageSeconds) * 1.0e9));
+    }
+
+    if (midiEvents.push (e))
+        return true;
+
+    DBG ("SynthEngine MIDI queue full, dropping message");
+    return false;
+}
+
+void SynthEngine::loadPreset (std::unique_ptr<const SynthPreset> preset)
+{
+    presets.publish (std::move (preset));
+}
+
+void SynthEngine::releaseRetiredSnapshots()
+{
+    presets.releaseRetired();
+    modulationPlans.releaseRetired();
+}
+
+SynthPreset SynthEngine::getCurrentSettings() const
+{
+    SynthPreset settings;
+
+    for (int i = 0; i < numParameters; ++i)
+        settings.set ((ParameterID) i, parameters.get ((ParameterID) i));
+
+    settings.waveform = currentWaveform.load (std::memory_order_relaxed);
+    settings.filterType = currentFilterType.load (std::memory_order_relaxed);
+    settings.unisonVoices = currentUnisonVoices.load (std::memory_order_relaxed);
+    settings.oscillator = currentOscillator.load (std::memory_order_relaxed);
+    return settings;
+}
+
+void SynthEngine::setOversampling (int factor) noexcept
+{
+    jassert (factor == 1 || factor == 2 || factor == 4 || factor == 8);
+    oversampling.store (juce::jlimit (1, maxOversampling, juce::nextPowerOfTwo (factor)), std::memory_order_relaxed);
+}
+
+bool SynthEngine::postEvent (SynthEvent e)
+{
+    // A zero timestamp puts the event at the start of the next block
+    e.timeNs = eventTiming.load (std::memory_order_relaxed) == EventTiming::timestamped ? getCurrentTimeNs() : 0;
+
+    if (events.push (e))
+        return true;
+
+    DBG ("SynthEngine event queue full, dropping event");
+    return false;
+}
+
+//==============================================================================
+void SynthEngine::collectEvents (uint64_t blockTimeNs, int numSamples) noexcept
+{
+    const auto blockLengthNs = (uint64_t) ((double) numSamples * 1.0e9 / sampleRate);
+    const auto windowStartNs = blockTimeNs > blockLengthNs ? blockTimeNs - blockLengthNs : 0;
+
+    numScheduledEvents = 0;
+    SynthEvent e;
+
+    // Anything beyond maxEventsPerBlock stays queued for the next block
+    while (numScheduledEvents < maxEventsPerBlock && events.pop (e))
+        scheduleEvent (e, windowStartNs, numSamples);
+
+    while (numScheduledEvents < maxEventsPerBlock && midiEvents.pop (e))
+        scheduleEvent (e, windowStartNs, numSamples);
+}
+
+void SynthEngine::scheduleEvent (const SynthEvent& e, uint64_t windowStartNs, int numSamples) noexcept
+{
+    auto offset = 0;
+
+    if (e.timeNs > windowStartNs)
+        offset = (int) juce::jmin ((double) (numSamples - 1),
+                                   (double) (e.timeNs - windowStartNs) * sampleRate * 1.0e-9);
+
+    // Insertion sort: events usually arrive in order, and equal offsets keep their order,
+    // which also interleaves the UI's events and the MIDI ones by time
+    auto i = numScheduledEvents++;
+
+    for (; i > 0 && scheduledEvents[(size_t) i - 1].sampleOffset > offset; --i)
+        scheduledEvents[(size_t) i] = scheduledEvents[(size_t) i - 1];
+
+    scheduledEvents[(size_t) i] = { e, offset };
+}
+
+void SynthEngine::handleEvent (const SynthEvent& e) noexcept
+{
+    switch (e.type)
+    {
+        case SynthEvent::Type::noteOn:
+            startNote (e.key, e.frequency, e.value);
+            break;
+
+        case SynthEvent::Type::noteOff:
+            releaseNote (e.key);
+            break;
+
+        case SynthEvent::Type::allNotesOff:
+            voices.releaseAll();
+            sustainedKeys.fill (false);
+
+            for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+                voices.envelopeStage[voices.getActiveVoices()[i]] = VoicePool::EnvelopeStage::release;
+
+            break;
+
+        case SynthEvent::Type::waveform:
+            renderSettings.waveform = (Waveform) juce::jlimit (0, numWaveforms - 1, (int) e.value);
+            currentWaveform.store (renderSettings.waveform, std::memory_order_relaxed);
+            break;
+
+        case SynthEvent::Type::filterType:
+            filterType = (FilterType) juce::jlimit (0, numFilterTypes - 1, (int) e.value);
+            filterCutoff = -1.0f;   // forces the coefficients to be remade
+            currentFilterType.store (filterType, std::memory_order_relaxed);
+            break;
+
+        case SynthEvent::Type::unisonVoices:
+            unisonVoices = juce::jlimit (1, VoicePool::maxUnison, (int) e.value);
+            currentUnisonVoices.store (unisonVoices, std::memory_order_relaxed);
+            break;
+
+        case SynthEvent::Type::pitchBend:
+            pitchBendRatio = std::exp2 (e.value * pitchBendRangeSemitones / 12.0f);
+
+            for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+            {
+                auto v = voices.getActiveVoices()[i];
+                setVoiceFrequency (v, voices.frequency[v]);
+            }
+
+            break;
+
+        case SynthEvent::Type::controller:
+            if (juce::isPositiveAndBelow (e.key, (int) controllers.size()))
+                handleController (e.key, e.value);
+
+            break;
+
+        case SynthEvent::Type::oscillator:
+            renderSettings.oscillator = (OscillatorType) juce::jlimit (0, numOscillatorTypes - 1, (int) e.value);
+            currentOscillator.store (renderSettings.oscillator, std::memory_order_relaxed);
+
+            // The wavetables don't need the streams, so let them go
+            if (renderSettings.oscillator != OscillatorType::sample)
+                for (int v = 0; v < VoicePool::maxVoices; ++v)
+                    sampleStreamer.stopVoice (v);
+
+            break;
+    }
+}
+
+void SynthEngine::applyPendingPreset() noexcept
+{
+    auto* preset = presets.getLatest();
+
+    if (preset == nullptr || preset == currentPreset)
+        return;
+
+    currentPreset = preset;
+
+    // The parameters go through the store, so the smoothers ramp to them as if the UI
+    // had moved every control at once
+    for (int i = 0; i < numParameters; ++i)
+        parameters.set ((ParameterID) i, preset->get ((ParameterID) i));
+
+    handleEvent ({ SynthEvent::Type::waveform, 0, (float) preset->waveform });
+    handleEvent ({ SynthEvent::Type::filterType, 0, (float) preset->filterType });
+    handleEvent ({ SynthEvent::Type::unisonVoices, 0, (float) preset->unisonVoices });
+    handleEvent ({ SynthEvent::Type::oscillator, 0, (float) preset->oscillator });
+
+    // From here on the audio thread only reads this preset or a newer one, so anything
+    // published before it can be freed
+    presets.markApplied (preset);
+}
+
+void SynthEngine::applyPendingModulation() noexcept
+{
+    auto* plan = modulationPlans.getLatest();
+
+    if (plan == nullptr || plan == modulation)
+        return;
+
+    modulation = plan;
+    modulationPlans.markApplied (plan);
+}
+
+void SynthEngine::handleController (int controller, float value) noexcept
+{
+    controllers[(size_t) controller] = value;
+
+    switch (controller)
+    {
+        case sustainPedalController:
+        {
+            const auto wasDown = sustainPedalDown;
+            sustainPedalDown = value >= 0.5f;
+
+            // Lifting the pedal releases everything it was holding
+            if (wasDown && ! sustainPedalDown)
+            {
+                for (int key = 0; key < (int) sustainedKeys.size(); ++key)
+                {
+                    if (sustainedKeys[(size_t) key])
+                    {
+                        sustainedKeys[(size_t) key] = false;
+                        releaseNote (key);
+                    }
+                }
+            }
+
+            break;
+        }
+
+        case allSoundOffController:
+        case allNotesOffController:
+            handleEvent ({ SynthEvent::Type::allNotesOff });
+            break;
+
+        case resetAllControllersController:
+            handleEvent ({ SynthEvent::Type::pitchBend });
+            handleController (sustainPedalController, 0.0f);
+            controllers.fill (0.0f);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void SynthEngine::startNote (int key, double frequencyHz, float velocity) noexcept
+{
+    auto wasPlaying = voices.getVoiceForKey (key) >= 0;
+    auto v = voices.startVoice (key);
+
+    // A voice taken over from another note keeps its phase and filter state, and
+    // attacks from its current level, so there's no discontinuity
+    if (! wasPlaying && voices.level[v] <= 0.0f)
+        voices.resetVoiceState (v);
+
+    if (juce::isPositiveAndBelow (key, (int) sustainedKeys.size()))
+        sustainedKeys[(size_t) key] = false;
+
+    voicePitchModulation[(size_t) v] = 1.0f;
+    setVoiceFrequency (v, frequencyHz);
+    voices.velocity[v] = velocity;
+    voices.gain[v] = velocity;
+    voices.envelopeStage[v] = VoicePool::EnvelopeStage::attack;
+    newestVoice = v;
+
+    if (renderSettings.oscillator == OscillatorType::sample)
+    {
+        // The play button's note isn't a MIDI key, so it plays the sample nearest its pitch
+        const auto sampleKey = juce::isPositiveAndBelow (key, 128) ? key
+                                                                   : juce::roundToInt (69.0 + 12.0 * std::log2 (frequencyHz / 440.0));
+        sampleStreamer.startVoice (v, sampleKey);
+    }
+    else
+    {
+        sampleStreamer.stopVoice (v);
+    }
+}
+
+void SynthEngine::releaseNote (int key) noexcept
+{
+    // The pedal holds MIDI notes, but not the one from the UI's play button
+    if (sustainPedalDown && juce::isPositiveAndBelow (key, (int) sustainedKeys.size()))
+    {
+        if (voices.getVoiceForKey (key) >= 0)
+            sustainedKeys[(size_t) key] = true;
+
+        return;
+    }
+
+    auto v = voices.releaseVoice (key);
+
+    if (v >= 0)
+        voices.envelopeStage[v] = VoicePool::EnvelopeStage::release;
+}
+
+void SynthEngine::setVoiceFrequency (int voice, double frequencyHz) noexcept
+{
+    voices.frequency[voice] = frequencyHz;
+
+    // The renderers limit this, once they know the unison and audio-rate pitch ratios on top
+    voices.increment[voice] = (float) (frequencyHz * pitchBendRatio * voicePitchModulation[(size_t) voice] / voiceSampleRate);
+}
+
+void SynthEngine::updateNoteFrequency (int key, double frequencyHz) noexcept
+{
+    auto v = voices.getVoiceForKey (key);
+
+    if (v >= 0 && voices.frequency[v] != frequencyHz)
+        setVoiceFrequency (v, frequencyHz);
+}
+
+//==============================================================================
+void SynthEngine::renderBlock (float* const* outputChannelData, int numOutputChannels, int numSamples,
+                               const uint64_t* hostTimeNs)
+{
+    if (numSamples <= 0)
+        return;
+
+    const juce::ScopedNoDenormals noDenormals;
+
+    collectEvents (hostTimeNs != nullptr ? *hostTimeNs : getCurrentTimeNs(), numSamples);
+
+    if (mixBuffer.getNumSamples() == 0)
+    {
+        for (int i = 0; i < numScheduledEvents; ++i)
+            handleEvent (scheduledEvents[(size_t) i].event);
+
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+            juce::FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+
+        return;
+    }
+
+    updateOversampling();
+    applyPendingPreset();
+    applyPendingModulation();
+    sampleStreamer.beginBlock();
+
+    // Read each parameter once per block; the smoothers take it from there
+    for (int i = 0; i < numParameters; ++i)
+        smoothers[(size_t) i].setTarget (parameters.get ((ParameterID) i));
+
+    auto& volume = smoothers[(size_t) ParameterID::volume];
+    auto nextEvent = 0;
+
+    // The effects ramp their own settings
+    auto target = [this] (ParameterID id) { return smoothers[(size_t) id].getTargetValue(); };
+
+    EffectsChain::Settings effectSettings;
+    effectSettings.chorusMix = target (ParameterID::chorusMix);
+    effectSettings.chorusRate = target (ParameterID::chorusRate);
+    effectSettings.chorusDepth = target (ParameterID::chorusDepth);
+    effectSettings.delayMix = target (ParameterID::delayMix);
+    effectSettings.delayBeats = target (ParameterID::delayTime);
+    effectSettings.delayFeedback = target (ParameterID::delayFeedback);
+    effectSettings.tempo = target (ParameterID::tempo);
+    effectSettings.reverbMix = target (ParameterID::reverbMix);
+
+    renderInParallel = renderWorkers != nullptr && numSamples >= minParallelBlockSize;
+
+    for (int chunkStart = 0; chunkStart < numSamples;)
+    {
+        const auto chunkEnd = chunkStart + juce::jmin (numSamples - chunkStart, mixBuffer.getNumSamples());
+        auto* mixLeft = mixBuffer.getWritePointer (0);
+        auto* mixRight = mixBuffer.getWritePointer (1);
+
+        juce::FloatVectorOperations::clear (mixLeft, chunkEnd - chunkStart);
+        juce::FloatVectorOperations::clear (mixRight, chunkEnd - chunkStart);
+
+        // Split the chunk at every event, and at least every controlBlockSize samples
+        for (auto position = chunkStart; position < chunkEnd;)
+        {
+            while (nextEvent < numScheduledEvents && scheduledEvents[(size_t) nextEvent].sampleOffset <= position)
+                handleEvent (scheduledEvents[(size_t) nextEvent++].event);
+
+            auto segmentEnd = juce::jmin (chunkEnd, position + controlBlockSize);
+
+            if (nextEvent < numScheduledEvents)
+                segmentEnd = juce::jmin (segmentEnd, scheduledEvents[(size_t) nextEvent].sampleOffset);
+
+            renderSegment (mixLeft + (position - chunkStart), mixRight + (position - chunkStart), segmentEnd - position);
+            position = segmentEnd;
+        }
+
+        const auto chunkLength = chunkEnd - chunkStart;
+        effects.process (mixLeft, mixRight, chunkLength, effectSettings);
+
+        if (volume.isSmoothing())
+        {
+            auto* gain = mixBuffer.getWritePointer (2);
+            volume.fill (gain, chunkLength);
+            juce::FloatVectorOperations::multiply (mixLeft, gain, chunkLength);
+            juce::FloatVectorOperations::multiply (mixRight, gain, chunkLength);
+        }
+        else
+        {
+            juce::FloatVectorOperations::multiply (mixLeft, volume.getTargetValue(), chunkLength);
+            juce::FloatVectorOperations::multiply (mixRight, volume.getTargetValue(), chunkLength);
+        }
+
+        if (numOutputChannels == 1)
+        {
+            juce::FloatVectorOperations::add (mixLeft, mixRight, chunkLength);
+            juce::FloatVectorOperations::copyWithMultiply (outputChannelData[0] + chunkStart, mixLeft, 0.5f, chunkLength);
+        }
+        else
+        {
+            for (int channel = 0; channel < numOutputChannels; ++channel)
+                juce::FloatVectorOperations::copy (outputChannelData[channel] + chunkStart,
+                                                   (channel % 2) == 0 ? mixLeft : mixRight, chunkLength);
+        }
+
+        chunkStart = chunkEnd;
+    }
+}
+
+void SynthEngine::updateFilterCoefficients() noexcept
+{
+    auto cutoff = smoothers[(size_t) ParameterID::cutoff].getCurrentValue() * fastExp2 (cutoffModulation);
+    auto resonance = smoothers[(size_t) ParameterID::resonance].getCurrentValue();
+
+    // Only remake the coefficients when something they depend on has moved
+    if (cutoff == filterCutoff && resonance == filterResonance)
+        return;
+
+    filterCutoff = cutoff;
+    filterResonance = resonance;
+
+    auto g = tables->filterTable.getPrewarpedGain ((float) (cutoff / voiceSampleRate));
+    renderSettings.filter = SVFCoefficients::make (g, resonance, filterType);
+}
+
+void SynthEngine::updateUnison() noexcept
+{
+    auto detune = smoothers[(size_t) ParameterID::detune].getCurrentValue() + detuneModulation;
+    auto spread = smoothers[(size_t) ParameterID::stereoSpread].getCurrentValue();
+
+    // The pitch ratios only need recomputing when the stack changes, not per voice or sample
+    if (detune == unisonDetune && spread == unisonSpread && unisonVoices == renderSettings.unison.numVoices)
+        return;
+
+    unisonDetune = detune;
+    unisonSpread = spread;
+    renderSettings.unison.update (unisonVoices, detune, spread);
+}
+
+void SynthEngine::updateEnvelopes() noexcept
+{
+    // The envelopes advance once per rendered sample, so they run at the oversampled rate
+    const auto minimumSamples = minimumEnvelopeSeconds * voiceSampleRate;
+    const auto getRate = [&] (ParameterID id)
+    {
+        return (float) (1.0 / juce::jmax (minimumSamples, smoothers[(size_t) id].getCurrentValue() * voiceSampleRate));
+    };
+
+    // Rates are full-scale: a 100 ms decay takes 100 ms to fall from 1 to 0
+    const auto attackRate = getRate (ParameterID::attack);
+    const auto decayRate = getRate (ParameterID::decay);
+    const auto releaseRate = getRate (ParameterID::release);
+    const auto sustain = smoothers[(size_t) ParameterID::sustain].getCurrentValue();
+
+    for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+        auto& stage = voices.envelopeStage[v];
+
+        if (stage == VoicePool::EnvelopeStage::attack && voices.level[v] >= 1.0f)
+            stage = VoicePool::EnvelopeStage::decay;
+
+        switch (stage)
+        {
+            case VoicePool::EnvelopeStage::attack:
+                voices.levelDelta[v] = attackRate;
+                voices.levelFloor[v] = 0.0f;
+                voices.levelCeiling[v] = 1.0f;
+                break;
+
+            case VoicePool::EnvelopeStage::decay:
+                // Head for the sustain level from whichever side we're on, so moving
+                // the sustain slider while a note is held doesn't jump
+                if (voices.level[v] > sustain)
+                {
+                    voices.levelDelta[v] = -decayRate;
+                    voices.levelFloor[v] = sustain;
+                    voices.levelCeiling[v] = 1.0f;
+                }
+                else
+                {
+                    voices.levelDelta[v] = attackRate;
+                    voices.levelFloor[v] = 0.0f;
+                    voices.levelCeiling[v] = sustain;
+                }
+                break;
+
+            case VoicePool::EnvelopeStage::release:
+                voices.levelDelta[v] = -releaseRate;
+                voices.levelFloor[v] = 0.0f;
+                voices.levelCeiling[v] = 1.0f;
+                break;
+        }
+    }
+}
+
+void SynthEngine::updateModulation() noexcept
+{
+    using Source = ModulationSource;
+    using Destination = ModulationDestination;
+
+    const auto& plan = *modulation;
+    auto& sources = modulationSources;
+
+    sources[(size_t) Source::lfo1] = lfoSine (lfoPhase[0]);
+    sources[(size_t) Source::lfo2] = lfoTriangle (lfoPhase[1]);
+    sources[(size_t) Source::modWheel] = controllers[(size_t) modWheelController];
+
+    // Cutoff and detune are shared by every voice, so they follow the newest note's envelope and velocity
+    const auto newestIsPlaying = newestVoice >= 0 && voices.state[newestVoice] != VoicePool::State::free;
+    sources[(size_t) Source::envelope] = newestIsPlaying ? voices.level[newestVoice] : 0.0f;
+    sources[(size_t) Source::velocity] = newestIsPlaying ? voices.velocity[newestVoice] : 0.0f;
+
+    std::array<float, numModulationDestinations> destinations {};
+    ModulationPlan::run (plan.sharedSteps.data(), plan.numSharedSteps, sources.data(), destinations.data());
+    cutoffModulation = destinations[(size_t) Destination::cutoff];
+    detuneModulation = destinations[(size_t) Destination::detune];
+
+    // Once a plan stops modulating the voices, one more pass puts them back
+    if (plan.numVoiceSteps == 0 && ! voiceModulationActive)
+        return;
+
+    voiceModulationActive = plan.numVoiceSteps > 0;
+    auto voiceSources = sources;
+
+    for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+
+        voiceSources[(size_t) Source::envelope] = voices.level[v];
+        voiceSources[(size_t) Source::velocity] = voices.velocity[v];
+        destinations.fill (0.0f);
+        ModulationPlan::run (plan.voiceSteps.data(), plan.numVoiceSteps, voiceSources.data(), destinations.data());
+
+        const auto semitones = juce::jlimit (-maxBlockRatePitchSemitones, maxBlockRatePitchSemitones,
+                                             destinations[(size_t) Destination::pitch]);
+        const auto ratio = fastExp2 (semitones * (1.0f / 12.0f));
+        voices.gain[v] = voices.velocity[v] * juce::jmax (0.0f, 1.0f + destinations[(size_t) Destination::volume]);
+
+        if (ratio != voicePitchModulation[(size_t) v])
+        {
+            voicePitchModulation[(size_t) v] = ratio;
+            setVoiceFrequency (v, voices.frequency[v]);
+        }
+    }
+}
+
+void SynthEngine::updateAudioRateModulation (int numVoiceSamples) noexcept
+{
+    using Source = ModulationSource;
+    using Destination = ModulationDestination;
+
+    const auto& plan = *modulation;
+
+    if (plan.numAudioSteps == 0)
+    {
+        renderSettings.audioRate = nullptr;
+        return;
+    }
+
+    // Audio-rate routes only read the shared sources, so only the LFOs move within the segment
+    auto sources = modulationSources;
+    const auto lfo1Increment = smoothers[(size_t) ParameterID::lfo1Rate].getCurrentValue() / voiceSampleRate;
+    const auto lfo2Increment = smoothers[(size_t) ParameterID::lfo2Rate].getCurrentValue() / voiceSampleRate;
+    const auto modulatesCutoff = plan.audioDestinations[(size_t) Destination::cutoff];
+
+    auto& out = audioRateModulation;
+    out.maxPitchRatio = 1.0f;
+
+    for (int s = 0; s < numVoiceSamples; ++s)
+    {
+        const auto phase1 = lfoPhase[0] + s * lfo1Increment;
+        const auto phase2 = lfoPhase[1] + s * lfo2Increment;
+        sources[(size_t) Source::lfo1] = lfoSine (phase1);
+        sources[(size_t) Source::lfo2] = lfoTriangle (phase2 - std::floor (phase2));
+
+        std::array<float, numModulationDestinations> destinations {};
+        ModulationPlan::run (plan.audioSteps.data(), plan.numAudioSteps, sources.data(), destinations.data());
+
+        const auto semitones = juce::jlimit (-maxAudioRatePitchSemitones, maxAudioRatePitchSemitones,
+                                             destinations[(size_t) Destination::pitch]);
+        out.pitchRatio[s] = fastExp2 (semitones * (1.0f / 12.0f));
+        out.maxPitchRatio = juce::jmax (out.maxPitchRatio, out.pitchRatio[s]);
+        audioRateVolume[(size_t) s] = juce::jmax (0.0f, 1.0f + destinations[(size_t) Destination::volume]);
+
+        // Remaking the coefficients every sample is the expensive part, so only do it if asked
+        if (modulatesCutoff)
+        {
+            const auto cutoff = filterCutoff * fastExp2 (destinations[(size_t) Destination::cutoff]);
+            out.filter[s] = SVFCoefficients::make (tables->filterTable.getPrewarpedGain ((float) (cutoff / voiceSampleRate)),
+                                                   filterResonance, filterType);
+        }
+        else
+        {
+            out.filter[s] = renderSettings.filter;
+        }
+    }
+
+    renderSettings.audioRate = &out;
+}
+
+void SynthEngine::advanceLfos (int numSamples) noexcept
+{
+    const ParameterID rates[] = { ParameterID::lfo1Rate, ParameterID::lfo2Rate };
+
+    for (size_t i = 0; i < lfoPhase.size(); ++i)
+    {
+        lfoPhase[i] += smoothers[(size_t) rates[i]].getCurrentValue() * numSamples / sampleRate;
+        lfoPhase[i] -= std::floor (lfoPhase[i]);
+    }
+}
+
+void SynthEngine::renderSegment (float* mixLeft, float* mixRight, int numSamples) noexcept
+{
+    updateNoteFrequency (uiNoteKey, smoothers[(size_t) ParameterID::noteFrequency].getCurrentValue());
+    updateModulation();
+    updateFilterCoefficients();
+    updateUnison();
+    updateEnvelopes();
+
+    // Volume is ramped per sample in renderBlock(); everything else moves once per segment
+    for (int i = 0; i < numParameters; ++i)
+        if (i != (int) ParameterID::volume)
+            smoothers[(size_t) i].skip (numSamples);
+
+    if (renderSettings.oscillator == OscillatorType::sample)
+        sampleStreamer.serviceIfOffline();
+
+    renderVoices (mixLeft, mixRight, numSamples);
+    advanceLfos (numSamples);
+}
+
+void SynthEngine::updateOversampling() noexcept
+{
+    const auto factor = oversampling.load (std::memory_order_relaxed);
+
+    if (factor == oversamplingFactor)
+        return;
+
+    oversamplingFactor = factor;
+    voiceSampleRate = sampleRate * factor;
+    oversampler = getOversampler (factor);
+
+    // Filter history from a different rate would ring, so start the new one clean
+    if (oversampler != nullptr)
+        oversampler->reset();
+
+    // Retune the voices and remake the filter for the new rate
+    for (auto i = 0; i < voices.getNumActiveVoices(); ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+        setVoiceFrequency (v, voices.frequency[v]);
+    }
+
+    filterCutoff = -1.0f;
+}
+
+juce::dsp::Oversampling<float>* SynthEngine::getOversampler (int factor) const noexcept
+{
+    switch (factor)
+    {
+        case 2:     return oversamplers[0].get();
+        case 4:     return oversamplers[1].get();
+        case 8:     return oversamplers[2].get();
+        default:    return nullptr;
+    }
+}
+
+void SynthEngine::renderVoices (float* mixLeft, float* mixRight, int numSamples) noexcept
+{
+    if (oversampler == nullptr)
+    {
+        mixVoices (mixLeft, mixRight, numSamples);
+    }
+    else
+    {
+        // The segment is silent at this point, so the upsampled block is only used as
+        // somewhere to render at the higher rate; downsampling then filters it into place
+        float* channels[] = { mixLeft, mixRight };
+        juce::dsp::AudioBlock<float> block (channels, 2, (size_t) numSamples);
+
+        auto oversampled = oversampler->processSamplesUp (block);
+        oversampled.clear();
+        mixVoices (oversampled.getChannelPointer (0), oversampled.getChannelPointer (1), (int) oversampled.getNumSamples());
+        oversampler->processSamplesDown (block);
+    }
+
+    // Iterate backwards, because finished voices are swap-removed from the active list
+    for (auto i = voices.getNumActiveVoices(); --i >= 0;)
+    {
+        auto v = voices.getActiveVoices()[i];
+
+        if (voices.envelopeStage[v] == VoicePool::EnvelopeStage::release && voices.level[v] <= 0.0f)
+        {
+            sampleStreamer.stopVoice (v);
+            voices.freeVoice (v);
+        }
+    }
+}
+
+void SynthEngine::mixVoices (float* mixLeft, float* mixRight, int numSamples) noexcept
+{
+    const auto simd = renderPath.load (std::memory_order_relaxed) == RenderPath::simd;
+
+    updateAudioRateModulation (numSamples);
+
+    if (const auto numTasks = getNumVoiceTasks (numSamples); numTasks > 1)
+    {
+        voiceJob = { mixLeft, mixRight, numSamples, numTasks, simd };
+        renderWorkers->run (renderVoiceTask, this, numTasks);
+
+        // The first task rendered straight into the mix, and the others into their own
+        for (int task = 1; task < numTasks; ++task)
+        {
+            const auto* partial = partialMixes.data() + 2 * (task - 1) * maxVoiceSegmentSize;
+            juce::FloatVectorOperations::add (mixLeft, partial, numSamples);
+            juce::FloatVectorOperations::add (mixRight, partial + maxVoiceSegmentSize, numSamples);
+        }
+    }
+    else if (renderSettings.oscillator == OscillatorType::sample)
+    {
+        VoiceRenderer::renderSamples (voices, renderSettings, mixLeft, mixRight, numSamples);
+    }
+    else if (simd)
+    {
+        VoiceRenderer::renderSIMD (voices, renderSettings, mixLeft, mixRight, numSamples);
+    }
+    else
+    {
+        VoiceRenderer::renderScalar (voices, renderSettings, mixLeft, mixRight, numSamples);
+    }
+
+    // Audio-rate volume is the same for every voice, so it can be applied to their mix
+    if (renderSettings.audioRate != nullptr && modulation->audioDestinations[(size_t) ModulationDestination::volume])
+    {
+        juce::FloatVectorOperations::multiply (mixLeft, audioRateVolume.data(), numSamples);
+        juce::FloatVectorOperations::multiply (mixRight, audioRateVolume.data(), numSamples);
+    }
+}
+
+int SynthEngine::getNumVoiceTasks (int numSamples) const noexcept
+{
+    if (! renderInParallel || numSamples < minParallelSegmentSize)
+        return 1;
+
+    const auto numActive = voices.getNumActiveVoices();
+    const auto numGroups = (numActive + VoiceRenderer::voiceGroupSize - 1) / VoiceRenderer::voiceGroupSize;
+    const auto numWorthSplitting = numActive * renderSettings.unison.numVoices / minOscillatorsPerTask;
+
+    return juce::jlimit (1, renderWorkers->getNumWorkers() + 1, juce::jmin (numGroups, numWorthSplitting));
+}
+
+void SynthEngine::renderVoiceTask (void* context, int task) noexcept
+{
+    auto& engine = *static_cast<SynthEngine*> (context);
+    const auto& job = engine.voiceJob;
+
+    // Share out whole groups of voices as evenly as they go, so each range fills its SIMD registers
+    const auto numActive = engine.voices.getNumActiveVoices();
+    const auto numGroups = (numActive + VoiceRenderer::voiceGroupSize - 1) / VoiceRenderer::voiceGroupSize;
+    const auto firstVoice = juce::jmin (numActive, numGroups * task / job.numTasks * VoiceRenderer::voiceGroupSize);
+    const auto endVoice = juce::jmin (numActive, numGroups * (task + 1) / job.numTasks * VoiceRenderer::voiceGroupSize);
+
+    auto* mixLeft = job.mixLeft;
+    auto* mixRight = job.mixRight;
+
+    if (task > 0)
+    {
+        mixLeft = engine.partialMixes.data() + 2 * (task - 1) * maxVoiceSegmentSize;
+        mixRight = mixLeft + maxVoiceSegmentSize;
+        juce::FloatVectorOperations::clear (mixLeft, job.numSamples);
+        juce::FloatVectorOperations::clear (mixRight, job.numSamples);
+    }
+
+    if (engine.renderSettings.oscillator == OscillatorType::sample)
+        VoiceRenderer::renderSamples (engine.voices, engine.renderSettings, mixLeft, mixRight, job.numSamples, firstVoice, endVoice);
+    else if (job.simd)
+        VoiceRenderer::renderSIMD (engine.voices, engine.renderSettings, mixLeft, mixRight, job.numSamples, firstVoice, endVoice);
+    else
+        VoiceRenderer::renderScalar (engine.voices, engine.renderSettings, mixLeft, mixRight, job.numSamples, firstVoice, endVoice);
+}
@@ -0,0 +1,406 @@
+/*
+  ==============================================================================
+
+    The polyphonic synth engine, independent of any UI.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "EffectsChain.h"
+#include "LockFreeFifo.h"
+#include "Modulation.h"
+#include "RenderWorkerPool.h"
+#include "SampleStreamer.h"
+#include "SnapshotList.h"
+#include "StateVariableFilter.h"
+#include "SynthParameters.h"
+#include "SynthPreset.h"
+#include "VoicePool.h"
+#include "VoiceRenderer.h"
+#include "Wavetable.h"
+
+//==============================================================================
+/**
+    Renders a pool of wavetable voices into an output buffer. Each voice runs
+    a stack of up to VoicePool::maxUnison detuned oscillators -> state variable
+    filter -> ADSR envelope, and the stack can be spread across the stereo field.
+
+    The engine is driven from two threads. The control thread (normally the
+    message thread) writes continuous values into getParameters() and posts
+    discrete changes such as notes with the note and waveform methods below.
+    Those only push onto a lock-free queue; the audio thread drains it at the
+    start of each renderBlock(), so the two threads never share any other state.
+
+    Each event is stamped with the time it was posted, and renderBlock() splits
+    the block so that it takes effect at the matching sample. Events are placed
+    relative to a window one block long that ends at the block's own timestamp,
+    which keeps their spacing exact for a constant latency of one block.
+    Parameter changes are ramped by a ParameterSmoother: volume per sample, and
+    values that drive the voices every controlBlockSize samples.
+
+    MIDI input goes through a second queue with its own producer, so a MIDI thread
+    can post notes, pitch bend and controllers while the UI posts its own events.
+    MIDI messages keep the time they were received rather than the time they were
+    posted, so they land on the same sample grid as the UI's events.
+
+    With setNumRenderThreads(), large voice counts are split across a RenderWorkerPool:
+    each segment's active voices are divided into ranges, rendered in parallel into
+    separate mixes, and summed on the audio thread. Blocks and segments too short
+    for that to pay off, and small voice counts, are still rendered on the audio
+    thread alone.
+
+    setOversampling() renders the voices at 2, 4 or 8 times the sample rate and
+    brings them back down through juce::dsp::Oversampling's polyphase half-band
+    IIR filters, so the resonant filter's and oscillators' harmonics above Nyquist
+    don't fold back. Events, envelopes and parameter ramps keep their timing in
+    output samples whatever the factor.
+
+    loadPreset() switches every setting at once, at the start of a block. The preset
+    is published to the audio thread through an atomic pointer, and the audio thread
+    only ever reads it, so switching never blocks or allocates there. Presets the
+    audio thread has moved past are freed later, on a control thread, by
+    releaseRetiredSnapshots().
+
+    setModulation() hands over a ModulationPlan the same way. Two LFOs, the mod
+    wheel, and each voice's envelope and velocity can modulate pitch, cutoff,
+    volume and unison detune. Block-rate routes are evaluated once per control
+    block, alongside the parameters; audio-rate ones fill per-sample pitch,
+    filter and volume buffers for the segment, and only segments that have some
+    pay for them.
+
+    setOscillatorType() switches the voices from the wavetables to the samples
+    handed over with loadSamples(). Samples are streamed from disk by a
+    SampleStreamer, so a library can be far larger than memory; the audio thread
+    only ever copies frames that are already in memory.
+
+    Everything that's read-only once it's built is shared by every engine in the
+    process: the wavetables and filter table are built by the first engine and
+    freed with the last, sample libraries are reference-counted so one can be
+    handed to several engines, and the reverbs load impulse responses on one
+    shared thread. An engine's own memory is its voices, buffers and effects.
+
+    The voice mix goes through an EffectsChain (chorus, delay and convolution
+    reverb) before the master volume. Effects that are turned off, or whose tails
+    have died away, cost nothing.
+
+    prepare() does all of the allocation up front and must not run concurrently
+    with renderBlock().
+
+    The engine only depends on juce_core, juce_audio_basics, juce_audio_formats
+    and juce_dsp, and is built as its own SynthEngine library so it can run
+    without a GUI or an audio device.
+*/
+class SynthEngine
+{
+public:
+    /** The key used for notes started by the UI's play button. */
+    static constexpr int uiNoteKey = VoicePool::numKeys - 1;
+
+    /** The most samples rendered before voice-level parameters are updated. */
+    static constexpr int controlBlockSize = 32;
+
+    /** The clock used to timestamp events, in nanoseconds. It matches the clock
+        JUCE uses for AudioIODeviceCallbackContext::hostTimeNs where that is available.
+    */
+    static uint64_t getCurrentTimeNs() noexcept
+    {
+        return (uint64_t) (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks()) * 1.0e9);
+    }
+
+    /** Selects which VoiceRenderer loop renders the voices. */
+    enum class RenderPath
+    {
+        scalar,
+        simd
+    };
+
+    SynthEngine();
+
+    /** Allocates the mix buffer, oversamplers and effects. Call before rendering. */
+    void prepare (double newSampleRate, int maximumBlockSize);
+
+    //==============================================================================
+    /** Continuous parameters. Safe to write from any thread. */
+    ParameterStore& getParameters() noexcept            { return parameters; }
+
+    /** These queue an event for the audio thread, and may only be called from one
+        thread at a time. They return false if the queue was full and the event was
+        dropped.
+    */
+    bool noteOn (int key, double frequencyHz, float velocity);
+    bool noteOff (int key);
+    bool allNotesOff();
+    bool setWaveform (Waveform newWaveform);
+    bool setFilterType (FilterType newType);
+    bool setUnisonVoices (int numVoices);
+
+    /** Notes started after this play the chosen source. Sounding notes switch too,
+        but a note that was started on the wavetables stays silent in sample mode.
+    */
+    bool setOscillatorType (OscillatorType newType);
+
+    /** Hands a sample library to the audio thread, which switches to it at the start
+        of a block. Notes already playing samples finish on the library they started
+        on. Several engines can be given the same library. Call from any thread but the
+        audio thread.
+    */
+    void loadSamples (std::shared_ptr<const SampleLibrary> library)     { sampleStreamer.setLibrary (std::move (library)); }
+
+    /** Offline renderers call this with false, so samples are read on the rendering
+        thread and never underrun. Call before loadSamples().
+    */
+    void setStreamSamplesInBackground (bool shouldStream)               { sampleStreamer.setRealtime (shouldStream); }
+
+    /** How many times a voice has run ahead of the sample streaming thread and played silence. */
+    juce::uint64 getNumSampleUnderruns() const noexcept                 { return sampleStreamer.getNumUnderruns(); }
+
+    /** Gives the reverb an impulse response from a WAV or AIFF file, read in the
+        background. Until one is loaded it uses a generated room. Call from any thread
+        but the audio thread; an offline renderer calls it before prepare(), so the
+        impulse response is in place from the first block.
+    */
+    void loadImpulseResponse (const juce::File& file)                   { effects.loadImpulseResponse (file); }
+
+    /** Hands a complete preset to the audio thread, which switches to it at the start
+        of the next block. Parameter changes are ramped as usual, and sounding notes
+        carry on with the new settings.
+
+        The preset is kept until the audio thread has moved on to a newer one. Call
+        this from any thread but the audio thread; it takes a lock that only the
+        other control threads share.
+    */
+    void loadPreset (std::unique_ptr<const SynthPreset> preset);
+
+    /** Hands a compiled modulation plan to the audio thread, which switches to it at
+        the start of the next block. Like loadPreset(), call from any thread but the
+        audio thread.
+    */
+    void setModulation (std::unique_ptr<const ModulationPlan> plan)     { modulationPlans.publish (std::move (plan)); }
+
+    /** How far modulation can move the pitch each way, in semitones. Audio-rate
+        modulation is kept to an octave so the oscillators' phases never step by a
+        whole cycle in one sample.
+    */
+    static constexpr float maxAudioRatePitchSemitones = 12.0f;
+    static constexpr float maxBlockRatePitchSemitones = 48.0f;
+
+    /** Frees the presets and modulation plans the audio thread has finished with.
+        Publishing a new one does this too, but call it now and then so the last few
+        don't hang around.
+    */
+    void releaseRetiredSnapshots();
+
+    /** The current settings, as a preset to save. The parameters are the latest
+        values written; the waveform, filter type, unison size and oscillator are what the audio
+        thread was using at the end of the last block.
+    */
+    SynthPreset getCurrentSettings() const;
+
+    /** Queues a MIDI message for the audio thread. Notes, pitch bend, sustain and the
+        all-notes-off controllers are acted on, on every channel; other controllers are
+        kept for modulation.
+
+        This has its own queue, so it can be called from a MIDI input thread while the
+        methods above are called from another, but only from one thread at a time. The
+        message's timestamp must be on the Time::getMillisecondCounterHiRes() clock, in
+        seconds, as juce::MidiInput stamps them; a zero timestamp means "now". Returns
+        false if the engine has no use for the message or the queue was full.
+    */
+    bool postMidiMessage (const juce::MidiMessage& message);
+
+    /** How far a full pitch bend moves every note. */
+    static constexpr float pitchBendRangeSemitones = 2.0f;
+
+    /** How events are placed within the block that picks them up. */
+    enum class EventTiming
+    {
+        timestamped,    // at the sample matching the time they were posted, one block late
+        nextBlock       // at the start of the next block, for hosts that split blocks themselves
+    };
+
+    /** Offline renderers, which don't run in real time, use EventTiming::nextBlock and
+        render up to each event's sample position before posting it.
+    */
+    void setEventTiming (EventTiming newTiming) noexcept    { eventTiming.store (newTiming, std::memory_order_relaxed); }
+
+    /** Sets how many worker threads help the audio thread render the voices; 0, the
+        default, renders everything on the audio thread. Takes effect at the next
+        prepare(), which starts or stops the threads.
+    */
+    void setNumRenderThreads (int numThreads) noexcept      { numRenderThreads = juce::jlimit (0, maxRenderThreads, numThreads); }
+
+    static constexpr int maxRenderThreads = 8;
+
+    /** Sets how many times the output sample rate the voices are rendered at: 1, 2, 4
+        or 8. Safe to call from any thread; the change is picked up at the start of the
+        next block. Higher factors alias less and cost proportionally more.
+    */
+    void setOversampling (int factor) noexcept;
+
+    int getOversampling() const noexcept                    { return oversampling.load (std::memory_order_relaxed); }
+
+    static constexpr int maxOversampling = 8;
+
+    /** Switches between the SIMD and scalar voice loops. The scalar one is a
+        reference for checking the SIMD output, and is slower.
+    */
+    void setRenderPath (RenderPath newPath) noexcept    { renderPath.store (newPath, std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Replaces the contents of the output channels with the next block of audio,
+        applying any queued events at their sample positions. Call from the audio thread.
+
+        Even-numbered channels get the left side of the mix and odd-numbered ones the
+        right; a single channel gets both mixed down to mono.
+
+        hostTimeNs is the block's timestamp on the getCurrentTimeNs() clock, if the
+        audio device provides one; otherwise the current time is used.
+    */
+    void renderBlock (float* const* outputChannelData, int numOutputChannels, int numSamples,
+                      const uint64_t* hostTimeNs = nullptr);
+
+    /** Renders the next block into a stereo pair of channels, timed against the current time.
+        This is the entry point for hosts that don't get a timestamp from an audio device.
+    */
+    void process (float* const* outputChannelData, int numSamples)
+    {
+        renderBlock (outputChannelData, numOutputChannels, numSamples);
+    }
+
+    /** The number of channels process() writes. */
+    static constexpr int numOutputChannels = 2;
+
+    /** Only meaningful on the audio thread. */
+    int getNumActiveVoices() const noexcept     { return voices.getNumActiveVoices(); }
+
+    /** How many times a sounding voice has been taken for a new note. Only meaningful on the audio thread. */
+    int getNumVoiceSteals() const noexcept      { return voices.getNumSteals(); }
+
+private:
+    //==============================================================================
+    struct ScheduledEvent
+    {
+        SynthEvent event;
+        int sampleOffset;
+    };
+
+    /** One stereo range of voices for the render workers. */
+    struct VoiceRenderJob
+    {
+        float* mixLeft = nullptr;
+        float* mixRight = nullptr;
+        int numSamples = 0;
+        int numTasks = 0;
+        bool simd = true;
+    };
+
+    static constexpr int maxEventsPerBlock = 1024;
+
+    bool postEvent (SynthEvent);
+    void collectEvents (uint64_t blockTimeNs, int numSamples) noexcept;
+    void scheduleEvent (const SynthEvent&, uint64_t windowStartNs, int numSamples) noexcept;
+    void handleEvent (const SynthEvent&) noexcept;
+    void applyPendingPreset() noexcept;
+    void applyPendingModulation() noexcept;
+    void handleController (int controller, float value) noexcept;
+    void startNote (int key, double frequencyHz, float velocity) noexcept;
+    void releaseNote (int key) noexcept;
+    void setVoiceFrequency (int voice, double frequencyHz) noexcept;
+    void updateNoteFrequency (int key, double frequencyHz) noexcept;
+    void updateFilterCoefficients() noexcept;
+    void updateUnison() noexcept;
+    void updateEnvelopes() noexcept;
+    void updateModulation() noexcept;
+    void updateAudioRateModulation (int numVoiceSamples) noexcept;
+    void advanceLfos (int numSamples) noexcept;
+    void renderSegment (float* mixLeft, float* mixRight, int numSamples) noexcept;
+    void renderVoices (float* mixLeft, float* mixRight, int numSamples) noexcept;
+    void mixVoices (float* mixLeft, float* mixRight, int numSamples) noexcept;
+    void updateOversampling() noexcept;
+    juce::dsp::Oversampling<float>* getOversampler (int factor) const noexcept;
+    int getNumVoiceTasks (int numSamples) const noexcept;
+    static void renderVoiceTask (void* engine, int task) noexcept;
+
+    ParameterStore parameters;
+    LockFreeFifo<SynthEvent> events { maxEventsPerBlock };
+    LockFreeFifo<SynthEvent> midiEvents { maxEventsPerBlock };
+
+    std::array<ScheduledEvent, maxEventsPerBlock> scheduledEvents;
+    int numScheduledEvents = 0;
+    std::array<ParameterSmoother, numParameters> smoothers;
+
+    /** The tables that never change once they're built, shared by every engine in the process. */
+    struct SharedTables
+    {
+        SharedTables()
+        {
+            wavetables.build();
+            filterTable.build();
+        }
+
+        WavetableBank wavetables;
+        FilterCoefficientTable filterTable;
+    };
+
+    juce::SharedResourcePointer<SharedTables> tables;
+    VoicePool voices;
+    SampleStreamer sampleStreamer;
+    EffectsChain effects;
+    juce::AudioBuffer<float> mixBuffer;
+
+    // For 2x, 4x and 8x, all made in prepare() so switching never allocates
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, 3> oversamplers;
+    std::atomic<int> oversampling { 1 };
+
+    int numRenderThreads = 0;
+    std::unique_ptr<RenderWorkerPool> renderWorkers;
+    std::vector<float> partialMixes;                        // a stereo pair per task after the first, each
+                                                            // as long as an oversampled segment
+    VoiceRenderJob voiceJob;
+    bool renderInParallel = false;                          // whether this block is long enough to split
+
+    double sampleRate = 44100.0;
+    double voiceSampleRate = 44100.0;                       // sampleRate times the oversampling in use
+
+    SnapshotList<SynthPreset> presets;
+    SnapshotList<ModulationPlan> modulationPlans;
+
+    // The event-driven settings the audio thread is using, for getCurrentSettings()
+    std::atomic<Waveform> currentWaveform { Waveform::sine };
+    std::atomic<FilterType> currentFilterType { FilterType::lowpass };
+    std::atomic<int> currentUnisonVoices { 1 };
+    std::atomic<OscillatorType> currentOscillator { OscillatorType::wavetable };
+
+    std::atomic<RenderPath> renderPath { RenderPath::simd };
+    std::atomic<EventTiming> eventTiming { EventTiming::timestamped };
+
+    // Only touched by the audio thread
+    VoiceRenderSettings renderSettings;
+    const SynthPreset* currentPreset = nullptr;             // the last one switched to
+    const ModulationPlan* modulation = &noModulation;
+    ModulationPlan noModulation;
+    std::array<double, 2> lfoPhase {};                      // 0 - 1
+    std::array<float, numModulationSources> modulationSources {};   // the shared ones, for this control block
+    std::array<float, VoicePool::maxVoices> voicePitchModulation;   // frequency ratios
+    int newestVoice = -1;                                   // whose envelope and velocity modulate cutoff and detune
+    float cutoffModulation = 0.0f, detuneModulation = 0.0f; // octaves and cents, for this control block
+    bool voiceModulationActive = false;                     // whether the last block modulated any voice
+    AudioRateModulation audioRateModulation;
+    std::array<float, AudioRateModulation::maxSamples> audioRateVolume;
+    juce::dsp::Oversampling<float>* oversampler = nullptr;  // the one in use, or nullptr at 1x
+    int oversamplingFactor = 1;
+    FilterType filterType = FilterType::lowpass;
+    float filterCutoff = -1.0f, filterResonance = -1.0f;    // what the coefficients were made from
+    int unisonVoices = 1;
+    float unisonDetune = 0.0f, unisonSpread = -1.0f;        // what renderSettings.unison was made from
+    float pitchBendRatio = 1.0f;
+    bool sustainPedalDown = false;
+    std::array<bool, 128> sustainedKeys {};                 // released while the pedal was down
+    std::array<float, 128> controllers {};                  // the latest value of each MIDI controller
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SynthEngine)
+};
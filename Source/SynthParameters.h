@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    Parameter and event types shared by the UI and the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "ParameterSmoother.h"
+
+//==============================================================================
+/** Continuous parameters, stored in a ParameterStore. */
+enum class ParameterID
+{
+    volume = 0,         // 0 - 1
+    noteFrequency,      // Hz, the pitch of the note started by the UI's play button
+    attack,             // seconds
+    decay,              // seconds
+    sustain,            // 0 - 1
+    release,            // seconds
+    cutoff,             // Hz
+    resonance,          // 0 - 1
+    detune,             // cents, how far the outermost unison oscillators are detuned
+    stereoSpread,       // 0 - 1, how far the unison oscillators are panned apart
+    lfo1Rate,           // Hz
+    lfo2Rate,           // Hz
+    chorusMix,          // 0 - 1
+    chorusRate,         // Hz
+    chorusDepth,        // 0 - 1
+    delayMix,           // 0 - 1
+    delayTime,          // beats
+    delayFeedback,      // 0 - 1
+    tempo,              // beats per minute, for the delay
+    reverbMix,          // 0 - 1
+
+    numParameters
+};
+
+static constexpr int numParameters = (int) ParameterID::numParameters;
+
+/** The default value of each parameter, the range it's kept to, and how the
+    audio thread ramps changes to it.
+*/
+struct ParameterInfo
+{
+    float defaultValue, minValue, maxValue;
+    ParameterSmoother::Ramp ramp;
+
+    /** Limits a value from a preset, script or the UI to the range. */
+    float clamp (float value) const noexcept     { return juce::jlimit (minValue, maxValue, value); }
+};
+
+inline ParameterInfo getParameterInfo (ParameterID id) noexcept
+{
+    switch (id)
+    {
+        case ParameterID::volume:           return { 0.5f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::noteFrequency:    return { 440.0f,   8.0f,    20000.0f, ParameterSmoother::Ramp::exponential };
+        case ParameterID::attack:           return { 0.01f,    0.0f,    10.0f,    ParameterSmoother::Ramp::linear };
+        case ParameterID::decay:            return { 0.1f,     0.0f,    10.0f,    ParameterSmoother::Ramp::linear };
+        case ParameterID::sustain:          return { 0.7f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::release:          return { 0.5f,     0.0f,    10.0f,    ParameterSmoother::Ramp::linear };
+        case ParameterID::cutoff:           return { 2000.0f,  20.0f,   20000.0f, ParameterSmoother::Ramp::exponential };
+        case ParameterID::resonance:        return { 0.1f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::detune:           return { 0.0f,     -50.0f,  50.0f,    ParameterSmoother::Ramp::linear };
+        case ParameterID::stereoSpread:     return { 0.5f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::lfo1Rate:         return { 5.0f,     0.01f,   50.0f,    ParameterSmoother::Ramp::exponential };
+        case ParameterID::lfo2Rate:         return { 0.5f,     0.01f,   50.0f,    ParameterSmoother::Ramp::exponential };
+        case ParameterID::chorusMix:        return { 0.0f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::chorusRate:       return { 0.8f,     0.01f,   10.0f,    ParameterSmoother::Ramp::exponential };
+        case ParameterID::chorusDepth:      return { 0.3f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::delayMix:         return { 0.0f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::delayTime:        return { 0.75f,    0.0625f, 4.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::delayFeedback:    return { 0.35f,    0.0f,    0.95f,    ParameterSmoother::Ramp::linear };
+        case ParameterID::tempo:            return { 120.0f,   20.0f,   300.0f,   ParameterSmoother::Ramp::linear };
+        case ParameterID::reverbMix:        return { 0.0f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+        case ParameterID::numParameters:    break;
+    }
+
+    jassertfalse;
+    return { 0.0f,     0.0f,    1.0f,     ParameterSmoother::Ramp::linear };
+}
+
+/** The name used for a parameter in scripts and presets. */
+inline const char* getParameterName (ParameterID id) noexcept
+{
+    switch (id)
+    {
+        case ParameterID::volume:           return "volume";
+        case ParameterID::noteFrequency:    return "noteFrequency";
+        case ParameterID::attack:           return "attack";
+        case ParameterID::decay:            return "decay";
+        case ParameterID::sustain:          return "sustain";
+        case ParameterID::release:          return "release";
+        case ParameterID::cutoff:           return "cutoff";
+        case ParameterID::resonance:        return "resonance";
+        case ParameterID::detune:           return "detune";
+        case ParameterID::stereoSpread:     return "stereoSpread";
+        case ParameterID::lfo1Rate:         return "lfo1Rate";
+        case ParameterID::lfo2Rate:         return "lfo2Rate";
+        case ParameterID::chorusMix:        return "chorusMix";
+        case ParameterID::chorusRate:       return "chorusRate";
+        case ParameterID::chorusDepth:      return "chorusDepth";
+        case ParameterID::delayMix:         return "delayMix";
+        case ParameterID::delayTime:        return "delayTime";
+        case ParameterID::delayFeedback:    return "delayFeedback";
+        case ParameterID::tempo:            return "tempo";
+        case ParameterID::reverbMix:        return "reverbMix";
+        case ParameterID::numParameters:    break;
+    }
+
+    jassertfalse;
+    return "";
+}
+
+/** Looks up a parameter by the name getParameterName() gives it. Returns
+    ParameterID::numParameters if there isn't one.
+*/
+inline ParameterID parameterFromName (const juce::String& name) noexcept
+{
+    for (int i = 0; i < numParameters; ++i)
+        if (name == getParameterName ((ParameterID) i))
+            return (ParameterID) i;
+
+    return ParameterID::numParameters;
+}
+
+//==============================================================================
+/**
+    Holds the current value of every continuous parameter in an atomic.
+
+    Any thread can write a value at any rate; the audio thread reads a consistent
+    copy of each one at the start of every block. Values are in engine units
+    (see ParameterID), not the ranges the UI's sliders use.
+*/
+class ParameterStore
+{
+public:
+    ParameterStore()
+    {
+        for (int i = 0; i < numParameters; ++i)
+            set ((ParameterID) i, getParameterInfo ((ParameterID) i).defaultValue);
+    }
+
+    void set (ParameterID id, float newValue) noexcept
+    {
+        values[(size_t) id].store (newValue, std::memory_order_relaxed);
+    }
+
+    float get (ParameterID id) const noexcept
+    {
+        return values[(size_t) id].load (std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<float>, (size_t) numParameters> values;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterStore)
+};
+
+//==============================================================================
+/**
+    A discrete change for the audio thread to apply, such as a note starting.
+    Events are small and trivially copyable so they can go through a LockFreeFifo.
+
+    timeNs is when the event happened, on the clock returned by
+    SynthEngine::getCurrentTimeNs(); the engine uses it to place the event at the
+    right sample within a block. Zero means "as soon as possible".
+*/
+struct SynthEvent
+{
+    enum class Type : juce::uint8
+    {
+        noteOn,         // key, value = velocity, frequency
+        noteOff,        // key
+        allNotesOff,
+        waveform,       // value = (int) Waveform
+        filterType,     // value = (int) FilterType
+        unisonVoices,   // value = number of unison oscillators per voice
+        pitchBend,      // value = -1 to 1, across the engine's pitch bend range
+        controller,     // key = MIDI controller number, value = 0 - 1
+        oscillator      // value = (int) OscillatorType
+    };
+
+    Type type = Type::noteOn;
+    int key = 0;
+    float value = 0.0f;
+    double frequency = 0.0;
+    uint64_t timeNs = 0;
+};
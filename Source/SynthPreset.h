@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    A complete set of engine settings, switched to all at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SampleStreamer.h"
+#include "StateVariableFilter.h"
+#include "SynthParameters.h"
+#include "Wavetable.h"
+
+//==============================================================================
+/**
+    Everything that makes up a sound: every continuous parameter, plus the
+    waveform, filter type, unison size and oscillator that are normally changed by
+    events. A preset that plays samples doesn't say which ones: the library is
+    whatever was last loaded.
+
+    Presets are handed to SynthEngine::loadPreset() once they're complete and are
+    never changed after that, so the audio thread can read one without copying it
+    or taking a lock. Playback settings such as oversampling aren't part of a
+    preset, so loading one doesn't change the CPU load.
+*/
+struct SynthPreset
+{
+    /** A preset with every setting at its default. */
+    SynthPreset()
+    {
+        for (int i = 0; i < numParameters; ++i)
+            parameters[(size_t) i] = getParameterInfo ((ParameterID) i).defaultValue;
+    }
+
+    float get (ParameterID id) const noexcept           { return parameters[(size_t) id]; }
+    void set (ParameterID id, float newValue) noexcept  { parameters[(size_t) id] = newValue; }
+
+    juce::String name;
+    std::array<float, (size_t) numParameters> parameters;   // in engine units, see ParameterID
+    Waveform waveform = Waveform::sine;
+    FilterType filterType = FilterType::lowpass;
+    int unisonVoices = 1;
+    OscillatorType oscillator = OscillatorType::wavetable;
+};
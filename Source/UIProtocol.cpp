@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    The compact message format the web UI uses to send control changes.
+
+  ==============================================================================
+*/
+
+#include "UIProtocol.h"
+
+namespace
+{
+    const char* const controlNames[] = { "volume", "frequency", "detune", "unison", "spread",
+                                         "attack", "decay", "sustain", "release",
+                                         "cutoff", "resonance", "waveform", "filterType", "oversampling",
+                                         "oscillator", "lfo1Rate", "lfo2Rate",
+                                         "chorusMix", "chorusRate", "chorusDepth",
+                                         "delayMix", "delayTime", "delayFeedback", "tempo", "reverbMix" };
+
+    static_assert (std::size (controlNames) == (size_t) numUIControls);
+}
+
+//==============================================================================
+UIControlDispatcher::UIControlDispatcher (SynthEngine& e)
+    : engine (e)
+{
+    auto setParameter = [this] (UIControl control, ParameterID parameter, float scale)
+    {
+        handlers[(size_t) control] = { parameter, scale, nullptr };
+    };
+
+    auto setCustom = [this] (UIControl control, void (*function) (SynthEngine&, float))
+    {
+        handlers[(size_t) control] = { ParameterID::numParameters, 1.0f, function };
+    };
+
+    setParameter (UIControl::volume,        ParameterID::volume,        0.01f);     // percent to 0 - 1
+    setParameter (UIControl::frequency,     ParameterID::noteFrequency, 1.0f);
+    setParameter (UIControl::detune,        ParameterID::detune,        1.0f);
+    setParameter (UIControl::spread,        ParameterID::stereoSpread,  0.01f);
+    setParameter (UIControl::attack,        ParameterID::attack,        0.001f);    // ms to seconds
+    setParameter (UIControl::decay,         ParameterID::decay,         0.001f);
+    setParameter (UIControl::sustain,       ParameterID::sustain,       0.01f);
+    setParameter (UIControl::release,       ParameterID::release,       0.001f);
+    setParameter (UIControl::cutoff,        ParameterID::cutoff,        1.0f);
+    setParameter (UIControl::resonance,     ParameterID::resonance,     0.01f);
+    setParameter (UIControl::lfo1Rate,      ParameterID::lfo1Rate,      1.0f);
+    setParameter (UIControl::lfo2Rate,      ParameterID::lfo2Rate,      1.0f);
+    setParameter (UIControl::chorusMix,     ParameterID::chorusMix,     0.01f);
+    setParameter (UIControl::chorusRate,    ParameterID::chorusRate,    1.0f);
+    setParameter (UIControl::chorusDepth,   ParameterID::chorusDepth,   0.01f);
+    setParameter (UIControl::delayMix,      ParameterID::delayMix,      0.01f);
+    setParameter (UIControl::delayTime,     ParameterID::delayTime,     1.0f);
+    setParameter (UIControl::delayFeedback, ParameterID::delayFeedback, 0.01f);
+    setParameter (UIControl::tempo,         ParameterID::tempo,         1.0f);
+    setParameter (UIControl::reverbMix,     ParameterID::reverbMix,     0.01f);
+
+    setCustom (UIControl::unison, [] (SynthEngine& s, float v)
+    {
+        s.setUnisonVoices (juce::roundToInt (v));
+    });
+
+    setCustom (UIControl::waveform, [] (SynthEngine& s, float v)
+    {
+        s.setWaveform ((Waveform) juce::jlimit (0, numWaveforms - 1, juce::roundToInt (v)));
+    });
+
+    setCustom (UIControl::filterType, [] (SynthEngine& s, float v)
+    {
+        s.setFilterType ((FilterType) juce::jlimit (0, numFilterTypes - 1, juce::roundToInt (v)));
+    });
+
+    setCustom (UIControl::oversampling, [] (SynthEngine& s, float v)
+    {
+        s.setOversampling (1 << juce::jlimit (0, 3, juce::roundToInt (v)));
+    });
+
+    setCustom (UIControl::oscillator, [] (SynthEngine& s, float v)
+    {
+        s.setOscillatorType ((OscillatorType) juce::jlimit (0, numOscillatorTypes - 1, juce::roundToInt (v)));
+    });
+}
+
+void UIControlDispatcher::apply (int control, float value) noexcept
+{
+    if (! juce::isPositiveAndBelow (control, numUIControls) || ! std::isfinite (value))
+        return;
+
+    const auto& handler = handlers[(size_t) control];
+
+    if (handler.custom != nullptr)
+        handler.custom (engine, value);
+    else if (handler.parameter != ParameterID::numParameters)
+        engine.getParameters().set (handler.parameter, getParameterInfo (handler.parameter).clamp (value * handler.scale));
+}
+
+bool UIControlDispatcher::applyBatch (const juce::var& payload)
+{
+    if (! payload.isString())
+        return false;
+
+    {
+        // Decoded into the member block, rather than a new one for every batch
+        juce::MemoryOutputStream stream (batch, false);
+
+        if (! juce::Base64::convertFromBase64 (stream, payload.toString()))
+            return false;
+    }
+
+    if (batch.getSize() % (2 * sizeof (float)) != 0)
+        return false;
+
+    const auto* data = static_cast<const char*> (batch.getData());
+    const auto numChanges = batch.getSize() / (2 * sizeof (float));
+
+    auto readFloat = [] (const char* bytes)
+    {
+        float value;
+        auto bits = juce::ByteOrder::littleEndianInt (bytes);
+        std::memcpy (&value, &bits, sizeof (value));
+        return value;
+    };
+
+    for (size_t i = 0; i < numChanges; ++i)
+    {
+        const auto* change = data + i * 2 * sizeof (float);
+        const auto id = readFloat (change);
+
+        // Checked as a float, since converting NaN or an out-of-range value to int is undefined
+        if (std::isfinite (id) && id >= 0.0f && id < (float) numUIControls)
+            apply ((int) id, readFloat (change + sizeof (float)));
+    }
+
+    return true;
+}
+
+juce::var UIControlDispatcher::getControlValues (const SynthPreset& preset) const
+{
+    auto* values = new juce::DynamicObject();
+
+    for (int i = 0; i < numUIControls; ++i)
+    {
+        const auto& handler = handlers[(size_t) i];
+
+        if (handler.parameter != ParameterID::numParameters)
+            values->setProperty (controlNames[i], preset.get (handler.parameter) / handler.scale);
+    }
+
+    values->setProperty (controlNames[(size_t) UIControl::unison], preset.unisonVoices);
+    values->setProperty (controlNames[(size_t) UIControl::waveform], (int) preset.waveform);
+    values->setProperty (controlNames[(size_t) UIControl::filterType], (int) preset.filterType);
+    values->setProperty (controlNames[(size_t) UIControl::oscillator], (int) preset.oscillator);
+    return values;
+}
+
+int UIControlDispatcher::controlFromName (const juce::String& name)
+{
+    for (int i = 0; i < numUIControls; ++i)
+        if (name == controlNames[i])
+            return i;
+
+    return -1;
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    The compact message format the web UI uses to send control changes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SynthEngine.h"
+
+//==============================================================================
+/**
+    The UI's controls, by the numeric ID the web UI sends them with.
+    These must match ControlID in UI/app.js.
+*/
+enum class UIControl
+{
+    volume = 0,         // percent
+    frequency,          // Hz
+    detune,             // cents
+    unison,             // number of voices
+    spread,             // percent
+    attack,             // ms
+    decay,              // ms
+    sustain,            // percent
+    release,            // ms
+    cutoff,             // Hz
+    resonance,          // percent
+    waveform,           // Waveform, as a number
+    filterType,         // FilterType, as a number
+    oversampling,       // 0 - 3, for 1x, 2x, 4x or 8x
+    oscillator,         // OscillatorType, as a number
+    lfo1Rate,           // Hz
+    lfo2Rate,           // Hz
+    chorusMix,          // percent
+    chorusRate,         // Hz
+    chorusDepth,        // percent
+    delayMix,           // percent
+    delayTime,          // beats
+    delayFeedback,      // percent
+    tempo,              // beats per minute
+    reverbMix,          // percent
+
+    numControls
+};
+
+static constexpr int numUIControls = (int) UIControl::numControls;
+
+//==============================================================================
+/**
+    Applies control changes from the web UI to the engine.
+
+    The UI coalesces its changes and sends them at most once per animation frame,
+    as a "params" event whose payload is a base64-encoded little-endian Float32Array
+    of [id, value, id, value, ...]. applyBatch() decodes that into a reused buffer,
+    and each change is applied through a table indexed by control ID, which also
+    converts from the UI's units to the engine's. There's no JSON parsing, no
+    string comparison, and no var or DynamicObject per change.
+
+    Only used on the message thread.
+*/
+class UIControlDispatcher
+{
+public:
+    explicit UIControlDispatcher (SynthEngine& engine);
+
+    /** Applies one change, in the UI's units. Unknown IDs are ignored. */
+    void apply (int control, float value) noexcept;
+
+    /** Applies a batch of changes from a "params" event. Returns false if the payload
+        isn't a valid batch, in which case nothing is applied.
+    */
+    bool applyBatch (const juce::var& payload);
+
+    /** Looks up a control by the name older UIs used as a message type, such as
+        "volume". Returns -1 if there's no such control.
+    */
+    static int controlFromName (const juce::String& name);
+
+    /** A preset's settings in the UI's units, as an object keyed by control name, for
+        moving the UI's controls to match a preset that's been loaded. Controls that
+        aren't part of a preset are left out.
+    */
+    juce::var getControlValues (const SynthPreset& preset) const;
+
+private:
+    //==============================================================================
+    struct Handler
+    {
+        ParameterID parameter = ParameterID::numParameters;  // set with value * scale, unless...
+        float scale = 1.0f;
+        void (*custom) (SynthEngine&, float) = nullptr;      // ...this handles it instead
+    };
+
+    SynthEngine& engine;
+    std::array<Handler, (size_t) numUIControls> handlers;
+    juce::MemoryBlock batch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UIControlDispatcher)
+};
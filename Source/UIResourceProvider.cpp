@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    Serves the web UI and its image assets to the WebView, from a bundle
+    embedded in the app or straight from disk.
+
+  ==============================================================================
+*/
+
+#include "UIResourceProvider.h"
+
+//==============================================================================
+UIResourceProvider::UIResourceProvider (const void* zipData, size_t zipSize, size_t cacheBudgetBytes)
+    : bundle (std::make_unique<juce::ZipFile> (new juce::MemoryInputStream (zipData, zipSize, false), true)),
+      cacheBudget (cacheBudgetBytes)
+{
+    jassert (bundle->getNumEntries() > 0);
+}
+
+UIResourceProvider::UIResourceProvider (const juce::File& ui, size_t cacheBudgetBytes)
+    : uiDirectory (ui),
+      cacheBudget (cacheBudgetBytes)
+{
+}
+
+void UIResourceProvider::addDirectory (const juce::String& prefix, const juce::File& directory)
+{
+    directories.emplace_back (prefix.trimCharactersAtStart ("/").trimCharactersAtEnd ("/") + "/", directory);
+}
+
+std::optional<juce::WebBrowserComponent::Resource> UIResourceProvider::getResource (const juce::String& url)
+{
+    const auto path = getRequestPath (url);
+
+    juce::File file;
+    const juce::ZipFile::ZipEntry* entry = nullptr;
+
+    if (bundle != nullptr)
+        entry = bundle->getEntry (path);
+    else
+        file = resolve (path);
+
+    if (entry == nullptr && ! file.existsAsFile())
+    {
+        DBG ("UI resource not found: " + url);
+        return std::nullopt;
+    }
+
+    // Bundled entries never change, so this only matters on disk
+    const auto modificationTime = entry != nullptr ? entry->fileTime : file.getLastModificationTime();
+
+    const juce::ScopedLock sl (lock);
+
+    if (auto found = cacheIndex.find (path); found != cacheIndex.end())
+    {
+        auto cached = found->second;
+
+        // Edited since it was cached, so read it again
+        if (cached->modificationTime == modificationTime)
+        {
+            cache.splice (cache.begin(), cache, cached);
+            return juce::WebBrowserComponent::Resource { cached->data, getMimeType (path) };
+        }
+
+        cachedBytes -= cached->data.size();
+        cacheIndex.erase (found);
+        cache.erase (cached);
+    }
+
+    auto data = entry != nullptr ? readBundleEntry (*entry) : readFile (file);
+
+    if (data.size() <= cacheBudget / 4)
+    {
+        evictUntilFits (data.size());
+        cache.push_front ({ path, modificationTime, data });
+        cacheIndex[path] = cache.begin();
+        cachedBytes += data.size();
+    }
+
+    return juce::WebBrowserComponent::Resource { std::move (data), getMimeType (path) };
+}
+
+size_t UIResourceProvider::getCachedBytes() const
+{
+    const juce::ScopedLock sl (lock);
+    return cachedBytes;
+}
+
+//==============================================================================
+juce::String UIResourceProvider::getRequestPath (const juce::String& url)
+{
+    // Drop any query or fragment, and undo the URL encoding ("PNG%20Filmstripes" etc.)
+    auto path = juce::URL::removeEscapeChars (url.upToFirstOccurrenceOf ("?", false, false)
+                                                 .upToFirstOccurrenceOf ("#", false, false))
+                    .trimCharactersAtStart ("/");
+
+    return path.isEmpty() ? juce::String ("ui.html") : path;
+}
+
+juce::File UIResourceProvider::resolve (const juce::String& requestPath) const
+{
+    auto root = uiDirectory;
+    auto path = requestPath;
+
+    for (auto& [prefix, directory] : directories)
+    {
+        if (path.startsWith (prefix))
+        {
+            root = directory;
+            path = path.substring (prefix.length());
+            break;
+        }
+    }
+
+    auto file = root.getChildFile (path);
+
+    // Never serve anything outside the folder, whatever "../" the path contains
+    if (! file.isAChildOf (root))
+        return {};
+
+    return file;
+}
+
+std::vector<std::byte> UIResourceProvider::readFile (const juce::File& file)
+{
+    // Mapping the file avoids an intermediate buffer: the bytes go from the page cache
+    // straight into the vector the WebView is given
+    juce::MemoryMappedFile mapped (file, juce::MemoryMappedFile::readOnly);
+
+    if (auto* data = static_cast<const std::byte*> (mapped.getData()))
+        return { data, data + mapped.getSize() };
+
+    // Some filesystems can't be mapped, and empty files have no mapping
+    juce::MemoryBlock block;
+    file.loadFileAsData (block);
+
+    auto* bytes = static_cast<const std::byte*> (block.getData());
+    return { bytes, bytes + block.getSize() };
+}
+
+std::vector<std::byte> UIResourceProvider::readBundleEntry (const juce::ZipFile::ZipEntry& entry)
+{
+    std::vector<std::byte> data ((size_t) entry.uncompressedSize);
+
+    // Stored entries, like the PNGs, are copied straight out of the zip's memory,
+    // and deflated ones are inflated directly into the vector
+    std::unique_ptr<juce::InputStream> stream (bundle->createStreamForEntry (entry));
+
+    if (stream == nullptr || stream->read (data.data(), (int) data.size()) != (int) data.size())
+    {
+        jassertfalse;
+        return {};
+    }
+
+    return data;
+}
+
+void UIResourceProvider::evictUntilFits (size_t bytesNeeded)
+{
+    while (! cache.empty() && cachedBytes + bytesNeeded > cacheBudget)
+    {
+        auto& oldest = cache.back();
+        cachedBytes -= oldest.data.size();
+        cacheIndex.erase (oldest.path);
+        cache.pop_back();
+    }
+}
+
+//==============================================================================
+juce::String UIResourceProvider::getMimeType (const juce::String& path)
+{
+    const auto extension = path.fromLastOccurrenceOf (".", true, false).toLowerCase();
+
+    if (extension == ".html" || extension == ".htm")   return "text/html";
+    if (extension == ".css")                           return "text/css";
+    if (extension == ".js" || extension == ".mjs")     return "text/javascript";
+    if (extension == ".json")                          return "application/json";
+    if (extension == ".png")                           return "image/png";
+    if (extension == ".jpg" || extension == ".jpeg")   return "image/jpeg";
+    if (extension == ".gif")                           return "image/gif";
+    if (extension == ".svg")                           return "image/svg+xml";
+    if (extension == ".webp")                          return "image/webp";
+    if (extension == ".woff")                          return "font/woff";
+    if (extension == ".woff2")                         return "font/woff2";
+    if (extension == ".ttf")                           return "font/ttf";
+    if (extension == ".txt")                           return "text/plain";
+
+    return "application/octet-stream";
+}
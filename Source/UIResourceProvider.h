@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    Serves the web UI and its image assets to the WebView, from a bundle
+    embedded in the app or straight from disk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A resource provider for juce::WebBrowserComponent, so the WebView loads the UI
+    from memory or where it is on disk instead of from files the app writes first.
+
+    It serves from one of two sources:
+     - A zip bundle in memory, usually the one the build embeds as binary data.
+       The zip is read where it is, without copying it, and each entry is only
+       inflated when the WebView first asks for it.
+     - The UI folder on disk, with paths under a prefix added with addDirectory(),
+       such as "/Assets/...", coming from that directory instead. Files are read
+       through a memory-mapped view, and reread if they change.
+
+    Either way "/" maps to ui.html, and recently used files are kept in an LRU
+    cache with a fixed byte budget. Files bigger than a quarter of the budget are
+    served without being cached, so one large image can't push everything else out.
+
+    getResource() may be called on any thread.
+*/
+class UIResourceProvider
+{
+public:
+    static constexpr size_t defaultCacheBudget = 64 * 1024 * 1024;
+
+    /** Serves the contents of a zip file in memory, which must outlive the provider. */
+    UIResourceProvider (const void* zipData, size_t zipSize, size_t cacheBudgetBytes = defaultCacheBudget);
+
+    /** Serves files from a folder on disk. */
+    UIResourceProvider (const juce::File& uiDirectory, size_t cacheBudgetBytes = defaultCacheBudget);
+
+    /** Serves requests for "/<prefix>/..." from a different directory. Call this before
+        the WebView is created. Only applies when serving from disk.
+    */
+    void addDirectory (const juce::String& prefix, const juce::File& directory);
+
+    /** Looks up a request path such as "/styles.css". Returns nothing if there's no such
+        file, or if the path tries to reach outside the folder it maps to.
+    */
+    std::optional<juce::WebBrowserComponent::Resource> getResource (const juce::String& url);
+
+    /** The MIME type the WebView should be given for a file path. */
+    static juce::String getMimeType (const juce::String& path);
+
+    /** The number of bytes currently held in the cache. */
+    size_t getCachedBytes() const;
+
+private:
+    //==============================================================================
+    struct CacheEntry
+    {
+        juce::String path;
+        juce::Time modificationTime;
+        std::vector<std::byte> data;
+    };
+
+    static juce::String getRequestPath (const juce::String& url);
+    juce::File resolve (const juce::String& path) const;
+    static std::vector<std::byte> readFile (const juce::File& file);
+    std::vector<std::byte> readBundleEntry (const juce::ZipFile::ZipEntry& entry);
+    void evictUntilFits (size_t bytesNeeded);
+
+    std::unique_ptr<juce::ZipFile> bundle;
+    const juce::File uiDirectory;
+    std::vector<std::pair<juce::String, juce::File>> directories;
+    const size_t cacheBudget;
+
+    // Most recently used at the front
+    std::list<CacheEntry> cache;
+    std::unordered_map<juce::String, std::list<CacheEntry>::iterator> cacheIndex;
+    size_t cachedBytes = 0;
+
+    juce::CriticalSection lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UIResourceProvider)
+};
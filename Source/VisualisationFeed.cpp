@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    Meter, oscilloscope and spectrum data for the UI, analysed off the audio
+    thread.
+
+  ==============================================================================
+*/
+
+#include "VisualisationFeed.h"
+
+namespace
+{
+    /** How many of the latest samples the scope trace covers, before decimation. */
+    constexpr int scopeSourceSamples = VisualisationFeed::fftSize / 2;
+
+    constexpr float minimumFrequency = 20.0f;
+    constexpr float maximumFrequency = 20000.0f;
+    constexpr float minimumDecibels = -100.0f;
+}
+
+//==============================================================================
+VisualisationFeed::VisualisationFeed (FrameCallback onFrame, int framesPerSecond)
+    : juce::Thread ("Visualisation"),
+      frameCallback (std::move (onFrame)),
+      intervalMs (juce::jmax (1, 1000 / juce::jmax (1, framesPerSecond))),
+      ringLeft ((size_t) ringSize),
+      ringRight ((size_t) ringSize),
+      history ((size_t) fftSize),
+      fftData ((size_t) fftSize * 2)
+{
+}
+
+VisualisationFeed::~VisualisationFeed()
+{
+    stop();
+}
+
+void VisualisationFeed::start()
+{
+    startThread (juce::Thread::Priority::low);
+}
+
+void VisualisationFeed::stop()
+{
+    stopThread (1000);
+}
+
+void VisualisationFeed::prepare (double newSampleRate) noexcept
+{
+    sampleRate.store (newSampleRate, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void VisualisationFeed::push (const float* left, const float* right, int numSamples) noexcept
+{
+    if (right == nullptr)
+        right = left;
+
+    // Only as much as fits: the rest is dropped rather than waited for
+    const auto scope = ring.write (numSamples);
+
+    if (scope.blockSize1 > 0)
+    {
+        std::copy (left, left + scope.blockSize1, ringLeft.data() + scope.startIndex1);
+        std::copy (right, right + scope.blockSize1, ringRight.data() + scope.startIndex1);
+    }
+
+    if (scope.blockSize2 > 0)
+    {
+        std::copy (left + scope.blockSize1, left + scope.blockSize1 + scope.blockSize2, ringLeft.data() + scope.startIndex2);
+        std::copy (right + scope.blockSize1, right + scope.blockSize1 + scope.blockSize2, ringRight.data() + scope.startIndex2);
+    }
+
+    if (const auto numWritten = scope.blockSize1 + scope.blockSize2; numWritten < numSamples)
+        droppedSamples.store (droppedSamples.load (std::memory_order_relaxed) + (juce::uint64) (numSamples - numWritten),
+                              std::memory_order_relaxed);
+}
+
+//==============================================================================
+void VisualisationFeed::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (intervalMs);
+        drain();
+
+        const auto silent = peak[0] < silenceThreshold && peak[1] < silenceThreshold;
+
+        // One silent frame lets the UI fall back to zero, after which there's nothing new to show
+        if (silent && wasSilent)
+        {
+            numMeterSamples = 0;
+            continue;
+        }
+
+        wasSilent = silent;
+        analyse();
+        frameCallback (juce::Base64::toBase64 (frame.data(), sizeof (frame)));
+    }
+}
+
+int VisualisationFeed::drain()
+{
+    const auto scope = ring.read (ring.getNumReady());
+
+    auto consume = [this] (int start, int numSamples)
+    {
+        const auto* left = ringLeft.data() + start;
+        const auto* right = ringRight.data() + start;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            peak[0] = juce::jmax (peak[0], std::abs (left[i]));
+            peak[1] = juce::jmax (peak[1], std::abs (right[i]));
+            sumOfSquares[0] += left[i] * left[i];
+            sumOfSquares[1] += right[i] * right[i];
+        }
+
+        numMeterSamples += numSamples;
+
+        // Keep the latest fftSize samples, mixed to mono, oldest first
+        const auto numToKeep = juce::jmin (numSamples, fftSize);
+        const auto skip = numSamples - numToKeep;
+
+        std::copy (history.begin() + numToKeep, history.end(), history.begin());
+
+        for (int i = 0; i < numToKeep; ++i)
+            history[(size_t) (fftSize - numToKeep + i)] = 0.5f * (left[skip + i] + right[skip + i]);
+    };
+
+    consume (scope.startIndex1, scope.blockSize1);
+    consume (scope.startIndex2, scope.blockSize2);
+
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+void VisualisationFeed::analyse()
+{
+    auto* out = frame.data();
+
+    // Levels of everything since the previous frame
+    for (size_t channel = 0; channel < 2; ++channel)
+    {
+        out[channel] = peak[channel];
+        out[2 + channel] = numMeterSamples > 0 ? std::sqrt (sumOfSquares[channel] / (float) numMeterSamples) : 0.0f;
+        peak[channel] = 0.0f;
+        sumOfSquares[channel] = 0.0f;
+    }
+
+    numMeterSamples = 0;
+    out += numMeterValues;
+
+    // Start the scope trace on the latest rising zero crossing that leaves room for a
+    // whole trace, so a steady waveform stands still instead of scrolling
+    auto start = fftSize - scopeSourceSamples;
+
+    for (int i = fftSize - scopeSourceSamples; i > 0; --i)
+    {
+        if (history[(size_t) i - 1] < 0.0f && history[(size_t) i] >= 0.0f)
+        {
+            start = i;
+            break;
+        }
+    }
+
+    // Each point is the sample of largest magnitude in its slice, so peaks survive decimation
+    constexpr auto samplesPerPoint = scopeSourceSamples / scopePoints;
+
+    for (int point = 0; point < scopePoints; ++point)
+    {
+        auto value = 0.0f;
+
+        for (int i = 0; i < samplesPerPoint; ++i)
+        {
+            auto sample = history[(size_t) (start + point * samplesPerPoint + i)];
+
+            if (std::abs (sample) > std::abs (value))
+                value = sample;
+        }
+
+        out[point] = value;
+    }
+
+    out += scopePoints;
+
+    // Spectrum, as the loudest bin in each of spectrumBands log-spaced bands
+    std::copy (history.begin(), history.end(), fftData.begin());
+    std::fill (fftData.begin() + fftSize, fftData.end(), 0.0f);
+    window.multiplyWithWindowingTable (fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform (fftData.data(), true);
+
+    const auto rate = (float) sampleRate.load (std::memory_order_relaxed);
+    const auto topFrequency = juce::jmin (maximumFrequency, rate * 0.5f);
+    const auto binsPerHz = (float) fftSize / rate;
+    const auto magnitudeScale = 2.0f / (float) fftSize;
+
+    for (int band = 0; band < spectrumBands; ++band)
+    {
+        const auto low = minimumFrequency * std::pow (topFrequency / minimumFrequency, (float) band / spectrumBands);
+        const auto high = minimumFrequency * std::pow (topFrequency / minimumFrequency, (float) (band + 1) / spectrumBands);
+
+        const auto firstBin = juce::jlimit (0, fftSize / 2, (int) (low * binsPerHz));
+        const auto lastBin = juce::jlimit (firstBin + 1, fftSize / 2 + 1, (int) std::ceil (high * binsPerHz));
+
+        auto magnitude = 0.0f;
+
+        for (int bin = firstBin; bin < lastBin; ++bin)
+            magnitude = juce::jmax (magnitude, fftData[(size_t) bin]);
+
+        out[band] = juce::Decibels::gainToDecibels (magnitude * magnitudeScale, minimumDecibels);
+    }
+}
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    Meter, oscilloscope and spectrum data for the UI, analysed off the audio
+    thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+
+//==============================================================================
+/**
+    Carries the engine's output from the audio thread to a low-priority analysis
+    thread, which turns it into compact frames for the UI to draw.
+
+    The audio thread calls push() after rendering each block. That copies the
+    samples into a wait-free single-producer, single-consumer ring and does
+    nothing else. If the analysis thread falls behind, the samples that don't fit
+    are dropped, never waited for.
+
+    The analysis thread wakes up at most framesPerSecond times a second and drains
+    the ring. It measures the peak and RMS level of everything that arrived,
+    decimates the latest samples into a triggered oscilloscope trace, and runs a
+    juce::dsp::FFT over them for a log-frequency spectrum. Each frame is handed
+    to the frame callback as a base64-encoded little-endian Float32Array laid out
+    as:
+
+        [peakLeft, peakRight, rmsLeft, rmsRight,     linear gain since the last frame
+         scope * scopePoints,                        -1 to 1, the left and right mixed
+         spectrum * spectrumBands]                   dB, 20 Hz to 20 kHz on a log scale
+
+    The callback runs on the analysis thread. Frames stop while the output stays
+    silent, so an idle app doesn't keep the UI busy.
+*/
+class VisualisationFeed  : private juce::Thread
+{
+public:
+    static constexpr int scopePoints = 256;
+    static constexpr int spectrumBands = 64;
+    static constexpr int numMeterValues = 4;
+    static constexpr int frameSize = numMeterValues + scopePoints + spectrumBands;
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    using FrameCallback = std::function<void (const juce::String& base64Frame)>;
+
+    VisualisationFeed (FrameCallback onFrame, int framesPerSecond = 30);
+    ~VisualisationFeed() override;
+
+    /** Starts and stops the analysis thread. */
+    void start();
+    void stop();
+
+    /** Sets the sample rate the spectrum's frequency scale is worked out from.
+        Safe to call while running.
+    */
+    void prepare (double sampleRate) noexcept;
+
+    /** Called by the audio thread with each block it has rendered. Never blocks or allocates. */
+    void push (const float* left, const float* right, int numSamples) noexcept;
+
+    /** The number of samples dropped because the ring was full. */
+    juce::uint64 getNumDroppedSamples() const noexcept     { return droppedSamples.load (std::memory_order_relaxed); }
+
+private:
+    //==============================================================================
+    void run() override;
+
+    /** Reads everything in the ring into the history and the level meters. Returns the number of samples read. */
+    int drain();
+
+    /** Fills the frame from the history and the level meters, and resets the meters. */
+    void analyse();
+
+    static constexpr int ringSize = 1 << 15;    // enough for 192 kHz at 5 frames a second
+    static constexpr float silenceThreshold = 1.0e-5f;
+
+    const FrameCallback frameCallback;
+    const int intervalMs;
+
+    // The ring, written by the audio thread and read by the analysis thread
+    juce::AbstractFifo ring { ringSize };
+    std::vector<float> ringLeft, ringRight;
+    std::atomic<juce::uint64> droppedSamples { 0 };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    // Only touched by the analysis thread
+    std::vector<float> history;                 // the latest fftSize samples, mixed to mono
+    std::array<float, 2> peak {}, sumOfSquares {};
+    int numMeterSamples = 0;
+    bool wasSilent = false;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann };
+    std::vector<float> fftData;
+    std::array<float, frameSize> frame {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VisualisationFeed)
+};
@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    Fixed-size voice pool stored as a structure of arrays.
+
+  ==============================================================================
+*/
+
+#include "VoicePool.h"
+
+//==============================================================================
+VoicePool::VoicePool()
+{
+    reset();
+}
+
+void VoicePool::reset() noexcept
+{
+    heldVoices = {};
+    releasedVoices = {};
+    numActive = 0;
+    numFree = maxVoices;
+
+    for (int v = 0; v < maxVoices; ++v)
+    {
+        resetVoiceState (v);
+        increment[v] = 0.0f;
+        velocity[v] = 0.0f;
+        gain[v] = 0.0f;
+        level[v] = 0.0f;
+        levelDelta[v] = 0.0f;
+        levelFloor[v] = 0.0f;
+        levelCeiling[v] = 0.0f;
+        frequency[v] = 0.0;
+        key[v] = -1;
+        state[v] = State::free;
+        envelopeStage[v] = EnvelopeStage::release;
+        prevVoice[v] = nextVoice[v] = -1;
+        activeIndex[v] = -1;
+
+        // Popped from the back, so voice 0 is handed out first
+        freeVoices[v] = maxVoices - 1 - v;
+    }
+
+    std::fill (std::begin (keyToVoice), std::end (keyToVoice), -1);
+}
+
+void VoicePool::resetVoiceState (int voice) noexcept
+{
+    jassert (juce::isPositiveAndBelow (voice, maxVoices));
+
+    // Steps of the golden ratio never line up, however many sub-oscillators are in use
+    constexpr float phaseStep = 0.618034f;
+    float startPhase = 0.0f;
+
+    for (auto& p : unisonPhase[voice])
+    {
+        p = startPhase;
+        startPhase += phaseStep;
+        startPhase -= (float) (int) startPhase;
+    }
+
+    for (int channel = 0; channel < 2; ++channel)
+        filterState1[channel][voice] = filterState2[channel][voice] = 0.0f;
+
+    level[voice] = 0.0f;
+}
+
+//==============================================================================
+int VoicePool::startVoice (int newKey) noexcept
+{
+    jassert (juce::isPositiveAndBelow (newKey, numKeys));
+
+    auto voice = keyToVoice[newKey];
+
+    if (voice >= 0)
+    {
+        // Same key: retrigger the voice that is already playing it. No other note loses
+        // its voice, so it isn't a steal.
+        detach (voice);
+    }
+    else if (numFree > 0)
+    {
+        voice = freeVoices[--numFree];
+        activeIndex[voice] = numActive;
+        activeVoices[numActive++] = voice;
+    }
+    else
+    {
+        voice = releasedVoices.head >= 0 ? releasedVoices.head
+                                         : heldVoices.head;
+        jassert (voice >= 0);
+
+        detach (voice);
+        keyToVoice[key[voice]] = -1;
+        ++numSteals;
+    }
+
+    key[voice] = newKey;
+    keyToVoice[newKey] = voice;
+    state[voice] = State::held;
+    pushBack (heldVoices, voice);
+
+    return voice;
+}
+
+int VoicePool::releaseVoice (int releasedKey) noexcept
+{
+    jassert (juce::isPositiveAndBelow (releasedKey, numKeys));
+
+    auto voice = keyToVoice[releasedKey];
+
+    if (voice < 0 || state[voice] != State::held)
+        return -1;
+
+    unlink (heldVoices, voice);
+    pushBack (releasedVoices, voice);
+    state[voice] = State::released;
+
+    return voice;
+}
+
+void VoicePool::releaseAll() noexcept
+{
+    while (heldVoices.head >= 0)
+        releaseVoice (key[heldVoices.head]);
+}
+
+void VoicePool::freeVoice (int voice) noexcept
+{
+    jassert (juce::isPositiveAndBelow (voice, maxVoices) && state[voice] != State::free);
+
+    detach (voice);
+
+    if (keyToVoice[key[voice]] == voice)
+        keyToVoice[key[voice]] = -1;
+
+    key[voice] = -1;
+    state[voice] = State::free;
+
+    // Swap-remove from the dense active list
+    auto index = activeIndex[voice];
+    auto last = activeVoices[--numActive];
+    activeVoices[index] = last;
+    activeIndex[last] = index;
+    activeIndex[voice] = -1;
+
+    freeVoices[numFree++] = voice;
+}
+
+//==============================================================================
+void VoicePool::pushBack (AgeList& list, int voice) noexcept
+{
+    prevVoice[voice] = list.tail;
+    nextVoice[voice] = -1;
+
+    if (list.tail >= 0)
+        nextVoice[list.tail] = voice;
+    else
+        list.head = voice;
+
+    list.tail = voice;
+}
+
+void VoicePool::unlink (AgeList& list, int voice) noexcept
+{
+    auto prev = prevVoice[voice];
+    auto next = nextVoice[voice];
+
+    if (prev >= 0)  nextVoice[prev] = next;
+    else            list.head = next;
+
+    if (next >= 0)  prevVoice[next] = prev;
+    else            list.tail = prev;
+
+    prevVoice[voice] = nextVoice[voice] = -1;
+}
+
+void VoicePool::detach (int voice) noexcept
+{
+    if (state[voice] == State::held)
+        unlink (heldVoices, voice);
+    else if (state[voice] == State::released)
+        unlink (releasedVoices, voice);
+}
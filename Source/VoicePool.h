@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Fixed-size voice pool stored as a structure of arrays.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+    Owns the state of every voice in the synth, laid out as one array per field
+    so the render loops can stream through it.
+
+    Nothing in here allocates: the pool is sized at compile time, and finding a
+    voice for a new note is O(1). Voices that are playing sit on one of two
+    intrusive lists, ordered by age. When the pool is full, a new note takes a
+    voice in this order:
+     - a voice that is already playing the same key,
+     - the oldest released voice (the one furthest into its release, so the quietest),
+     - the oldest held voice.
+*/
+class VoicePool
+{
+public:
+    static constexpr int maxVoices = 64;
+
+    /** The most detuned sub-oscillators a voice can stack in unison. */
+    static constexpr int maxUnison = 16;
+
+    /** Number of distinct note keys: the 128 MIDI notes plus one for the UI's play button. */
+    static constexpr int numKeys = 129;
+
+    enum class State : juce::uint8
+    {
+        free = 0,
+        held,
+        released
+    };
+
+    /** The stages of a voice's ADSR envelope. Decay also covers sustain: the level
+        heads towards the sustain value from whichever side it's on.
+    */
+    enum class EnvelopeStage : juce::uint8
+    {
+        attack = 0,
+        decay,
+        release
+    };
+
+    VoicePool();
+
+    /** Returns every voice to the free list. */
+    void reset() noexcept;
+
+    /** Clears a voice's oscillator and filter state, ready to start a note from silence.
+        The unison sub-oscillators start at spread-out phases so they don't all peak together.
+    */
+    void resetVoiceState (int voice) noexcept;
+
+    /** Finds a voice for a new note on the given key, stealing one if the pool is full.
+        The caller is responsible for initialising the voice's oscillator and envelope state.
+    */
+    int startVoice (int key) noexcept;
+
+    /** Moves the most recent voice playing the key into its release stage.
+        Returns the voice index, or -1 if nothing was playing that key.
+    */
+    int releaseVoice (int key) noexcept;
+
+    /** Moves every held voice into its release stage. */
+    void releaseAll() noexcept;
+
+    /** Returns a voice to the free list once it has finished sounding. */
+    void freeVoice (int voice) noexcept;
+
+    /** Returns the most recent voice playing a key, or -1. */
+    int getVoiceForKey (int key) const noexcept
+    {
+        jassert (juce::isPositiveAndBelow (key, numKeys));
+        return keyToVoice[key];
+    }
+
+    /** The voices that are currently sounding, in no particular order. */
+    const int* getActiveVoices() const noexcept     { return activeVoices; }
+    int getNumActiveVoices() const noexcept         { return numActive; }
+
+    /** Counts how many times a voice playing one key has been taken for another. */
+    int getNumSteals() const noexcept               { return numSteals; }
+
+    //==============================================================================
+    // Per-voice state, indexed by voice number. All of a voice's unison
+    // sub-oscillators advance from the one base increment, scaled by a ratio
+    // that is shared by every voice (see VoiceRenderSettings).
+    alignas (32) float unisonPhase[maxVoices][maxUnison];
+    alignas (32) float increment[maxVoices];
+    alignas (32) float velocity[maxVoices];
+    alignas (32) float gain[maxVoices];         // velocity, scaled by any volume modulation
+
+    // Envelope: each sample, level = clamp (level + levelDelta, levelFloor, levelCeiling)
+    alignas (32) float level[maxVoices];
+    alignas (32) float levelDelta[maxVoices];
+    alignas (32) float levelFloor[maxVoices];
+    alignas (32) float levelCeiling[maxVoices];
+
+    // The two integrator states of the voice's state variable filters, indexed [channel][voice]
+    alignas (32) float filterState1[2][maxVoices];
+    alignas (32) float filterState2[2][maxVoices];
+
+    double frequency[maxVoices];
+    int key[maxVoices];
+    State state[maxVoices];
+    EnvelopeStage envelopeStage[maxVoices];
+
+private:
+    //==============================================================================
+    struct AgeList
+    {
+        int head = -1, tail = -1;
+    };
+
+    void pushBack (AgeList&, int voice) noexcept;
+    void unlink (AgeList&, int voice) noexcept;
+    void detach (int voice) noexcept;
+
+    AgeList heldVoices, releasedVoices;
+    int prevVoice[maxVoices], nextVoice[maxVoices];
+
+    int freeVoices[maxVoices];
+    int numFree = 0;
+
+    int activeVoices[maxVoices];
+    int activeIndex[maxVoices];
+    int numActive = 0;
+
+    int keyToVoice[numKeys];
+    int numSteals = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoicePool)
+};
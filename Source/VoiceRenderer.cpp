@@ -0,0 +1,508 @@
+/*
+  ==============================================================================
+
+    Scalar and SIMD render loops for the voices in a VoicePool.
+
+  ==============================================================================
+*/
+
+#include "VoiceRenderer.h"
+
+namespace
+{
+    /** One step of the TPT state variable filter, for a float or a SIMDRegister of them. */
+    template <typename Type>
+    struct FilterKernel
+    {
+        Type a1, a2, a3, m0, m1, m2;
+
+        Type process (Type x, Type& s1, Type& s2) const noexcept
+        {
+            auto v3 = x - s2;
+            auto v1 = a1 * s1 + a2 * v3;
+            auto v2 = s2 + a2 * s1 + a3 * v3;
+            s1 = v1 + v1 - s1;
+            s2 = v2 + v2 - s2;
+
+            return m0 * x + m1 * v1 + m2 * v2;
+        }
+    };
+
+    FilterKernel<float> makeFilterKernel (const SVFCoefficients& f) noexcept
+    {
+        return { f.a1, f.a2, f.a3, f.m0, f.m1, f.m2 };
+    }
+}
+
+//==============================================================================
+void UnisonSettings::update (int numSubOscillators, float detuneCents, float stereoSpread) noexcept
+{
+    numVoices = juce::jlimit (1, VoicePool::maxUnison, numSubOscillators);
+    stereoSpread = juce::jlimit (0.0f, 1.0f, stereoSpread);
+    detuneCents = juce::jlimit (-maxDetuneCents, maxDetuneCents, detuneCents);
+
+    alignas (32) float cents[VoicePool::maxUnison];
+    alignas (32) float pan[VoicePool::maxUnison];
+
+    if (numVoices == 1)
+    {
+        cents[0] = detuneCents;
+        pan[0] = 0.0f;
+    }
+    else
+    {
+        for (int i = 0; i < numVoices; ++i)
+        {
+            auto position = -1.0f + 2.0f * (float) i / (float) (numVoices - 1);
+            cents[i] = detuneCents * position;
+            pan[i] = stereoSpread * position;
+        }
+    }
+
+    centsToRatios (cents, ratio, numVoices);
+    maxRatio = *std::max_element (ratio, ratio + numVoices);
+
+    // Equal-power panning, scaled so the centre is unity and the whole stack is
+    // about as loud as a single oscillator
+    const auto normalise = juce::MathConstants<float>::sqrt2 / std::sqrt ((float) numVoices);
+    stereo = false;
+
+    for (int i = 0; i < numVoices; ++i)
+    {
+        auto angle = (pan[i] + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+        gainLeft[i] = std::cos (angle) * normalise;
+        gainRight[i] = std::sin (angle) * normalise;
+        stereo = stereo || pan[i] != 0.0f;
+    }
+}
+
+//==============================================================================
+void VoiceRenderer::renderScalar (VoicePool& voices, const VoiceRenderSettings& settings,
+                                  float* mixLeft, float* mixRight, int numSamples,
+                                  int firstVoice, int endVoice) noexcept
+{
+    if (settings.audioRate != nullptr)
+        renderScalarLoop<true> (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+    else
+        renderScalarLoop<false> (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+}
+
+template <bool audioRate>
+void VoiceRenderer::renderScalarLoop (VoicePool& voices, const VoiceRenderSettings& settings,
+                                      float* mixLeft, float* mixRight, int numSamples,
+                                      int firstVoice, int endVoice) noexcept
+{
+    const auto* modulation = settings.audioRate;
+    auto filter = makeFilterKernel (settings.filter);
+
+    const auto& unison = settings.unison;
+    const auto numUnison = unison.numVoices;
+    const auto stereo = unison.isStereo();
+    const auto maxRatio = audioRate ? unison.maxRatio * modulation->maxPitchRatio : unison.maxRatio;
+    const auto maxVoiceIncrement = maxIncrement / maxRatio;
+
+    for (int i = firstVoice; i < endVoice; ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+
+        const auto inc = juce::jlimit (0.0f, maxVoiceIncrement, voices.increment[v]);
+        const auto* table = settings.wavetables->getTable (settings.waveform,
+                                                           WavetableBank::getLevelForIncrement (inc * maxRatio));
+        const auto gain = voices.gain[v];
+        const auto delta = voices.levelDelta[v];
+        const auto floor = voices.levelFloor[v];
+        const auto ceiling = voices.levelCeiling[v];
+
+        float increments[VoicePool::maxUnison];
+
+        for (int u = 0; u < numUnison; ++u)
+            increments[u] = inc * unison.ratio[u];
+
+        auto* phase = voices.unisonPhase[v];
+        auto level = voices.level[v];
+        auto left1 = voices.filterState1[0][v],  left2 = voices.filterState2[0][v];
+        auto right1 = voices.filterState1[1][v], right2 = voices.filterState2[1][v];
+
+        for (int s = 0; s < numSamples; ++s)
+        {
+            level = juce::jlimit (floor, ceiling, level + delta);
+
+            if constexpr (audioRate)
+                filter = makeFilterKernel (modulation->filter[s]);
+
+            auto xLeft = 0.0f, xRight = 0.0f;
+
+            for (int u = 0; u < numUnison; ++u)
+            {
+                auto x = WavetableBank::lookup (table, phase[u]);
+                xLeft += x * unison.gainLeft[u];
+                xRight += x * unison.gainRight[u];
+
+                if constexpr (audioRate)
+                    phase[u] += increments[u] * modulation->pitchRatio[s];
+                else
+                    phase[u] += increments[u];
+
+                phase[u] -= std::floor (phase[u]);
+            }
+
+            auto amplitude = gain * level;
+            auto yLeft = filter.process (xLeft, left1, left2);
+            auto yRight = stereo ? filter.process (xRight, right1, right2) : yLeft;
+
+            mixLeft[s] += yLeft * amplitude;
+            mixRight[s] += yRight * amplitude;
+        }
+
+        // A centred stack shares the left filter, so keep the right one in step
+        // for when the stack is spread out again
+        if (! stereo)
+        {
+            right1 = left1;
+            right2 = left2;
+        }
+
+        voices.level[v] = level;
+        voices.filterState1[0][v] = left1;
+        voices.filterState2[0][v] = left2;
+        voices.filterState1[1][v] = right1;
+        voices.filterState2[1][v] = right2;
+    }
+}
+
+//==============================================================================
+void VoiceRenderer::renderSamples (VoicePool& voices, const VoiceRenderSettings& settings,
+                                   float* mixLeft, float* mixRight, int numSamples,
+                                   int firstVoice, int endVoice) noexcept
+{
+    if (settings.audioRate != nullptr)
+        renderSamplesLoop<true> (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+    else
+        renderSamplesLoop<false> (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+}
+
+template <bool audioRate>
+void VoiceRenderer::renderSamplesLoop (VoicePool& voices, const VoiceRenderSettings& settings,
+                                       float* mixLeft, float* mixRight, int numSamples,
+                                       int firstVoice, int endVoice) noexcept
+{
+    jassert (settings.samples != nullptr);
+    auto& samples = *settings.samples;
+
+    const auto* modulation = settings.audioRate;
+    auto filter = makeFilterKernel (settings.filter);
+
+    // Frames are fetched a sub-block at a time into a window that starts with the two
+    // frames either side of the playback position
+    constexpr int subBlockSize = 64;
+    constexpr int windowSize = 2 + subBlockSize * SampleStreamer::maxIncrement + 1;
+    float windowLeft[windowSize], windowRight[windowSize];
+    float positions[subBlockSize];
+
+    for (int i = firstVoice; i < endVoice; ++i)
+    {
+        auto v = voices.getActiveVoices()[i];
+        auto& player = samples.getVoice (v);
+
+        const auto delta = voices.levelDelta[v];
+        const auto floor = voices.levelFloor[v];
+        const auto ceiling = voices.levelCeiling[v];
+        auto level = voices.level[v];
+
+        if (player.zone == nullptr)
+        {
+            // Nothing to play, but the envelope still runs so the voice ends on time
+            voices.level[v] = juce::jlimit (floor, ceiling, level + delta * (float) numSamples);
+            continue;
+        }
+
+        const auto gain = voices.gain[v];
+        const auto maxSampleIncrement = (float) SampleStreamer::maxIncrement;
+        const auto increment = juce::jlimit (0.0f, maxSampleIncrement, voices.increment[v] * player.incrementScale);
+        auto position = player.position;
+        auto left1 = voices.filterState1[0][v],  left2 = voices.filterState2[0][v];
+        auto right1 = voices.filterState1[1][v], right2 = voices.filterState2[1][v];
+
+        for (int start = 0; start < numSamples; start += subBlockSize)
+        {
+            const auto n = juce::jmin (subBlockSize, numSamples - start);
+            auto end = position + (float) n * increment;
+
+            // Work out every position first, so the frames can be fetched in one go
+            if constexpr (audioRate)
+            {
+                end = position;
+
+                for (int s = 0; s < n; ++s)
+                {
+                    positions[s] = end;
+                    end += juce::jmin (maxSampleIncrement, increment * modulation->pitchRatio[start + s]);
+                }
+            }
+
+            const auto numNewFrames = (int) end;
+
+            windowLeft[0] = player.held[0];
+            windowLeft[1] = player.next[0];
+            windowRight[0] = player.held[1];
+            windowRight[1] = player.next[1];
+            samples.readFrames (v, windowLeft + 2, windowRight + 2, numNewFrames);
+
+            for (int s = 0; s < n; ++s)
+            {
+                level = juce::jlimit (floor, ceiling, level + delta);
+
+                if constexpr (audioRate)
+                    filter = makeFilterKernel (modulation->filter[start + s]);
+
+                const auto p = audioRate ? positions[s] : position + (float) s * increment;
+                const auto index = (int) p;
+                const auto frac = p - (float) index;
+
+                auto xLeft = windowLeft[index] + frac * (windowLeft[index + 1] - windowLeft[index]);
+                auto xRight = windowRight[index] + frac * (windowRight[index + 1] - windowRight[index]);
+
+                auto amplitude = gain * level;
+                mixLeft[start + s] += filter.process (xLeft, left1, left2) * amplitude;
+                mixRight[start + s] += filter.process (xRight, right1, right2) * amplitude;
+            }
+
+            position = end - (float) numNewFrames;
+            player.held[0] = windowLeft[numNewFrames];
+            player.next[0] = windowLeft[numNewFrames + 1];
+            player.held[1] = windowRight[numNewFrames];
+            player.next[1] = windowRight[numNewFrames + 1];
+        }
+
+        player.position = position;
+        voices.level[v] = level;
+        voices.filterState1[0][v] = left1;
+        voices.filterState2[0][v] = left2;
+        voices.filterState1[1][v] = right1;
+        voices.filterState2[1][v] = right2;
+
+        if (samples.hasFinished (v))
+        {
+            voices.level[v] = 0.0f;
+            voices.envelopeStage[v] = VoicePool::EnvelopeStage::release;
+        }
+    }
+}
+
+//==============================================================================
+#if JUCE_USE_SIMD
+
+void VoiceRenderer::renderSIMD (VoicePool& voices, const VoiceRenderSettings& settings,
+                                float* mixLeft, float* mixRight, int numSamples,
+                                int firstVoice, int endVoice) noexcept
+{
+    if (settings.audioRate != nullptr)
+    {
+        jassert (numSamples <= AudioRateModulation::maxSamples);
+        renderSIMDLoop<true> (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+        return;
+    }
+
+    // The loop sums its lanes in a buffer of maxSamples, so longer ranges go in pieces
+    for (int start = 0; start < numSamples; start += AudioRateModulation::maxSamples)
+        renderSIMDLoop<false> (voices, settings, mixLeft + start, mixRight + start,
+                               juce::jmin (AudioRateModulation::maxSamples, numSamples - start),
+                               firstVoice, endVoice);
+}
+
+template <bool audioRate>
+void VoiceRenderer::renderSIMDLoop (VoicePool& voices, const VoiceRenderSettings& settings,
+                                    float* mixLeft, float* mixRight, int numSamples,
+                                    int firstVoice, int endVoice) noexcept
+{
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+    constexpr int numLanes = (int) FloatVec::size();
+
+    static_assert (voiceGroupSize % numLanes == 0, "Voice ranges should split at register boundaries");
+
+    const auto* activeVoices = voices.getActiveVoices();
+
+    const auto tableSize = FloatVec::expand ((float) WavetableBank::tableSize);
+
+    const auto expandFilter = [] (const SVFCoefficients& f)
+    {
+        return FilterKernel<FloatVec> { FloatVec::expand (f.a1), FloatVec::expand (f.a2), FloatVec::expand (f.a3),
+                                        FloatVec::expand (f.m0), FloatVec::expand (f.m1), FloatVec::expand (f.m2) };
+    };
+
+    const auto* modulation = settings.audioRate;
+    auto filter = expandFilter (settings.filter);
+
+    const auto& unison = settings.unison;
+    const auto numUnison = unison.numVoices;
+    const auto stereo = unison.isStereo();
+    const auto maxRatio = audioRate ? unison.maxRatio * modulation->maxPitchRatio : unison.maxRatio;
+    const auto maxVoiceIncrement = maxIncrement / maxRatio;
+
+    // Every group adds its lanes in here, and they're only summed across once the
+    // whole range of voices is done, rather than once per sample for each group
+    FloatVec laneLeft[AudioRateModulation::maxSamples], laneRight[AudioRateModulation::maxSamples];
+
+    for (int s = 0; s < numSamples; ++s)
+        laneLeft[s] = laneRight[s] = FloatVec::expand (0.0f);
+
+    for (int first = firstVoice; first < endVoice; first += numLanes)
+    {
+        const auto numInGroup = juce::jmin (numLanes, endVoice - first);
+
+        // Gather this group's voices into lanes. Unused lanes get zero gain and
+        // increment, so they add nothing to the mix.
+        alignas (32) float phase[VoicePool::maxUnison][numLanes];
+        alignas (32) float increment[numLanes], gain[numLanes];
+        alignas (32) float level[numLanes], delta[numLanes], floor[numLanes], ceiling[numLanes];
+        alignas (32) float left1[numLanes], left2[numLanes], right1[numLanes], right2[numLanes];
+        const float* tables[numLanes];
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (lane < numInGroup)
+            {
+                auto v = activeVoices[first + lane];
+
+                for (int u = 0; u < numUnison; ++u)
+                    phase[u][lane] = voices.unisonPhase[v][u];
+
+                increment[lane] = juce::jlimit (0.0f, maxVoiceIncrement, voices.increment[v]);
+                gain[lane]      = voices.gain[v];
+                level[lane]     = voices.level[v];
+                delta[lane]     = voices.levelDelta[v];
+                floor[lane]     = voices.levelFloor[v];
+                ceiling[lane]   = voices.levelCeiling[v];
+                left1[lane]     = voices.filterState1[0][v];
+                left2[lane]     = voices.filterState2[0][v];
+                right1[lane]    = voices.filterState1[1][v];
+                right2[lane]    = voices.filterState2[1][v];
+                tables[lane]    = settings.wavetables->getTable (settings.waveform,
+                                                                 WavetableBank::getLevelForIncrement (increment[lane] * maxRatio));
+            }
+            else
+            {
+                for (int u = 0; u < numUnison; ++u)
+                    phase[u][lane] = 0.0f;
+
+                increment[lane] = gain[lane] = 0.0f;
+                level[lane] = delta[lane] = floor[lane] = ceiling[lane] = 0.0f;
+                left1[lane] = left2[lane] = right1[lane] = right2[lane] = 0.0f;
+                tables[lane] = settings.wavetables->getTable (settings.waveform, 0);
+            }
+        }
+
+        const auto vIncrement = FloatVec::fromRawArray (increment);
+        FloatVec vPhase[VoicePool::maxUnison], vUnisonIncrement[VoicePool::maxUnison];
+
+        for (int u = 0; u < numUnison; ++u)
+        {
+            vPhase[u] = FloatVec::fromRawArray (phase[u]);
+            vUnisonIncrement[u] = vIncrement * unison.ratio[u];
+        }
+
+        auto vLevel = FloatVec::fromRawArray (level);
+        auto sLeft1 = FloatVec::fromRawArray (left1), sLeft2 = FloatVec::fromRawArray (left2);
+        auto sRight1 = FloatVec::fromRawArray (right1), sRight2 = FloatVec::fromRawArray (right2);
+        const auto vGain = FloatVec::fromRawArray (gain);
+        const auto vDelta = FloatVec::fromRawArray (delta);
+        const auto vFloor = FloatVec::fromRawArray (floor);
+        const auto vCeiling = FloatVec::fromRawArray (ceiling);
+
+        alignas (32) float index[numLanes], lower[numLanes], upper[numLanes];
+
+        for (int s = 0; s < numSamples; ++s)
+        {
+            vLevel = FloatVec::min (vCeiling, FloatVec::max (vFloor, vLevel + vDelta));
+
+            if constexpr (audioRate)
+                filter = expandFilter (modulation->filter[s]);
+
+            auto xLeft = FloatVec::expand (0.0f), xRight = FloatVec::expand (0.0f);
+
+            for (int u = 0; u < numUnison; ++u)
+            {
+                auto position = vPhase[u] * tableSize;
+                auto vIndex = FloatVec::truncate (position);
+                auto frac = position - vIndex;
+
+                // Each lane reads its own table, so the two interpolation points are fetched lane by lane
+                vIndex.copyToRawArray (index);
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                {
+                    auto i = (int) index[lane];
+                    lower[lane] = tables[lane][i];
+                    upper[lane] = tables[lane][i + 1];
+                }
+
+                auto vLower = FloatVec::fromRawArray (lower);
+                auto x = vLower + frac * (FloatVec::fromRawArray (upper) - vLower);
+
+                xLeft += x * unison.gainLeft[u];
+                xRight += x * unison.gainRight[u];
+
+                if constexpr (audioRate)
+                    vPhase[u] += vUnisonIncrement[u] * modulation->pitchRatio[s];
+                else
+                    vPhase[u] += vUnisonIncrement[u];
+
+                // The phase is never negative, so truncating it is a floor
+                vPhase[u] -= FloatVec::truncate (vPhase[u]);
+            }
+
+            auto amplitude = vGain * vLevel;
+            auto yLeft = filter.process (xLeft, sLeft1, sLeft2);
+            auto yRight = stereo ? filter.process (xRight, sRight1, sRight2) : yLeft;
+
+            laneLeft[s] += yLeft * amplitude;
+            laneRight[s] += yRight * amplitude;
+        }
+
+        if (! stereo)
+        {
+            sRight1 = sLeft1;
+            sRight2 = sLeft2;
+        }
+
+        for (int u = 0; u < numUnison; ++u)
+            vPhase[u].copyToRawArray (phase[u]);
+
+        vLevel.copyToRawArray (level);
+        sLeft1.copyToRawArray (left1);
+        sLeft2.copyToRawArray (left2);
+        sRight1.copyToRawArray (right1);
+        sRight2.copyToRawArray (right2);
+
+        for (int lane = 0; lane < numInGroup; ++lane)
+        {
+            auto v = activeVoices[first + lane];
+
+            for (int u = 0; u < numUnison; ++u)
+                voices.unisonPhase[v][u] = phase[u][lane];
+
+            voices.level[v] = level[lane];
+            voices.filterState1[0][v] = left1[lane];
+            voices.filterState2[0][v] = left2[lane];
+            voices.filterState1[1][v] = right1[lane];
+            voices.filterState2[1][v] = right2[lane];
+        }
+    }
+
+    for (int s = 0; s < numSamples; ++s)
+    {
+        mixLeft[s] += laneLeft[s].sum();
+        mixRight[s] += laneRight[s].sum();
+    }
+}
+
+#else
+
+void VoiceRenderer::renderSIMD (VoicePool& voices, const VoiceRenderSettings& settings,
+                                float* mixLeft, float* mixRight, int numSamples,
+                                int firstVoice, int endVoice) noexcept
+{
+    renderScalar (voices, settings, mixLeft, mixRight, numSamples, firstVoice, endVoice);
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    Scalar and SIMD render loops for the voices in a VoicePool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "PitchMath.h"
+#include "SampleStreamer.h"
+#include "StateVariableFilter.h"
+#include "VoicePool.h"
+#include "Wavetable.h"
+
+//==============================================================================
+/**
+    How each voice's unison sub-oscillators are tuned and panned. These are the
+    same for every voice, so they're worked out once whenever the detune or
+    spread changes rather than per voice or per sample.
+*/
+struct UnisonSettings
+{
+    /** Recalculates the tables for a number of sub-oscillators.
+
+        With more than one, they're spread evenly from -detuneCents to +detuneCents
+        and panned from left to right by stereoSpread (0 - 1). A single oscillator
+        is simply detuned by detuneCents and sits in the centre. detuneCents is
+        limited to +/- maxDetuneCents.
+    */
+    void update (int numSubOscillators, float detuneCents, float stereoSpread) noexcept;
+
+    /** The detune parameter's 50 cents, plus 50 from each of the five modulation
+        sources. Anything further would only come from a bad script or preset.
+    */
+    static constexpr float maxDetuneCents = 300.0f;
+
+    /** True when the sub-oscillators are panned apart, so the left and right
+        channels need filtering separately.
+    */
+    bool isStereo() const noexcept      { return stereo; }
+
+    int numVoices = 1;
+    float maxRatio = 1.0f;      // the largest ratio, which decides the wavetable level
+
+    alignas (32) float ratio[VoicePool::maxUnison] = { 1.0f };
+    alignas (32) float gainLeft[VoicePool::maxUnison] = { 1.0f };
+    alignas (32) float gainRight[VoicePool::maxUnison] = { 1.0f };
+
+private:
+    bool stereo = false;
+};
+
+//==============================================================================
+/**
+    Pitch and filter values for each sample of a segment, for modulation that runs
+    at audio rate. They apply to every voice, on top of each voice's own increment.
+*/
+struct AudioRateModulation
+{
+    /** The longest segment the engine renders, in samples at the highest oversampling. */
+    static constexpr int maxSamples = 256;
+
+    alignas (32) float pitchRatio[maxSamples];
+    SVFCoefficients filter[maxSamples];
+    float maxPitchRatio = 1.0f;     // the largest pitchRatio, which decides the wavetable level
+};
+
+//==============================================================================
+/** Everything the render loops need besides the voices themselves. */
+struct VoiceRenderSettings
+{
+    const WavetableBank* wavetables = nullptr;
+    Waveform waveform = Waveform::sine;
+    OscillatorType oscillator = OscillatorType::wavetable;
+    SampleStreamer* samples = nullptr;              // for OscillatorType::sample
+    SVFCoefficients filter;
+    UnisonSettings unison;
+    const AudioRateModulation* audioRate = nullptr;     // replaces filter when it's set
+};
+
+//==============================================================================
+/**
+    Renders every active voice in a pool and adds the result into a stereo mix.
+
+    Each voice runs its unison oscillators -> state variable filter -> envelope.
+    The filter runs once per channel when the unison stack is spread in stereo,
+    and once for both otherwise. renderSIMD()
+    packs the oscillator, filter and envelope state of several voices into the
+    lanes of a juce::dsp::SIMDRegister and advances them together. renderScalar()
+    is the straightforward one-voice-at-a-time reference, kept so the two can be
+    compared.
+
+    With settings.audioRate set, the pitch and filter change every sample. Each
+    loop is compiled twice, with and without that, so a segment without audio-rate
+    modulation runs exactly the loop it would otherwise.
+
+    Neither function moves voices between envelope stages or frees voices that have
+    finished; that's left to the caller.
+
+    Each can also render just a range of the pool's active voices, so separate
+    threads can render separate ranges into separate mixes at the same time.
+*/
+struct VoiceRenderer
+{
+    /** The furthest a wavetable sub-oscillator's phase can step in one sample, once
+        its unison ratio and any audio-rate pitch are applied. Each voice's increment
+        is limited so that none of its sub-oscillators go past it, which keeps them
+        below Nyquist and their phase within the table.
+    */
+    static constexpr float maxIncrement = 0.45f;
+
+    static void renderScalar (VoicePool& voices, const VoiceRenderSettings& settings,
+                              float* mixLeft, float* mixRight, int numSamples) noexcept
+    {
+        renderScalar (voices, settings, mixLeft, mixRight, numSamples, 0, voices.getNumActiveVoices());
+    }
+
+    static void renderSIMD (VoicePool& voices, const VoiceRenderSettings& settings,
+                            float* mixLeft, float* mixRight, int numSamples) noexcept
+    {
+        renderSIMD (voices, settings, mixLeft, mixRight, numSamples, 0, voices.getNumActiveVoices());
+    }
+
+    /** Render active voices firstVoice to endVoice - 1, in getActiveVoices() order. */
+    static void renderScalar (VoicePool& voices, const VoiceRenderSettings& settings,
+                              float* mixLeft, float* mixRight, int numSamples,
+                              int firstVoice, int endVoice) noexcept;
+
+    static void renderSIMD (VoicePool& voices, const VoiceRenderSettings& settings,
+                            float* mixLeft, float* mixRight, int numSamples,
+                            int firstVoice, int endVoice) noexcept;
+
+    /** Renders voices playing samples from settings.samples instead of wavetables. Each
+        voice plays one stereo sample, linearly interpolated, through both channels of
+        its filter; unison doesn't apply. A voice whose sample has run out is left at
+        zero level in its release stage, so the caller frees it.
+    */
+    static void renderSamples (VoicePool& voices, const VoiceRenderSettings& settings,
+                               float* mixLeft, float* mixRight, int numSamples,
+                               int firstVoice, int endVoice) noexcept;
+
+    static void renderSamples (VoicePool& voices, const VoiceRenderSettings& settings,
+                               float* mixLeft, float* mixRight, int numSamples) noexcept
+    {
+        renderSamples (voices, settings, mixLeft, mixRight, numSamples, 0, voices.getNumActiveVoices());
+    }
+
+    /** Ranges that start at a multiple of this fill whole SIMD registers, except
+        perhaps the last one.
+    */
+    static constexpr int voiceGroupSize = 8;
+
+    /** True if this build has a vectorised path; otherwise renderSIMD() falls back to renderScalar(). */
+    static constexpr bool isSIMDAvailable() noexcept
+    {
+       #if JUCE_USE_SIMD
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+private:
+    template <bool audioRate>
+    static void renderScalarLoop (VoicePool&, const VoiceRenderSettings&, float*, float*, int, int, int) noexcept;
+
+    template <bool audioRate>
+    static void renderSIMDLoop (VoicePool&, const VoiceRenderSettings&, float*, float*, int, int, int) noexcept;
+
+    template <bool audioRate>
+    static void renderSamplesLoop (VoicePool&, const VoiceRenderSettings&, float*, float*, int, int, int) noexcept;
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    Band-limited, mip-mapped wavetables for the synth's oscillators.
+
+  ==============================================================================
+*/
+
+#include "Wavetable.h"
+
+//==============================================================================
+Waveform waveformFromString (const juce::String& name)
+{
+    if (name == "square")    return Waveform::square;
+    if (name == "sawtooth")  return Waveform::sawtooth;
+    if (name == "triangle")  return Waveform::triangle;
+
+    return Waveform::sine;
+}
+
+//==============================================================================
+namespace
+{
+    /** Fourier series coefficient of partial n for a waveform, and whether it's a cosine term.
+        The series are chosen to match the phase and polarity of the naive shapes the
+        synth used to generate: the saw ramps up from -1 and the triangle starts at -1.
+    */
+    float getPartialAmplitude (Waveform waveform, int n, bool& isCosine) noexcept
+    {
+        constexpr auto pi = juce::MathConstants<float>::pi;
+        isCosine = false;
+
+        switch (waveform)
+        {
+            case Waveform::sine:        return n == 1 ? 1.0f : 0.0f;
+            case Waveform::square:      return (n & 1) != 0 ? 4.0f / (pi * (float) n) : 0.0f;
+            case Waveform::sawtooth:    return -2.0f / (pi * (float) n);
+            case Waveform::triangle:    isCosine = true;
+                                        return (n & 1) != 0 ? -8.0f / (pi * pi * (float) (n * n)) : 0.0f;
+        }
+
+        return 0.0f;
+    }
+}
+
+void WavetableBank::build()
+{
+    if (isBuilt())
+        return;
+
+    constexpr int mask = tableSize - 1;
+    constexpr int stride = tableSize + 1;
+
+    // One cycle of a sine, used to look up every partial without calling std::sin
+    juce::HeapBlock<float> sineTable (tableSize);
+
+    for (int i = 0; i < tableSize; ++i)
+        sineTable[i] = (float) std::sin (juce::MathConstants<double>::twoPi * i / tableSize);
+
+    tables.calloc ((size_t) (numWaveforms * numLevels * stride));
+
+    for (int w = 0; w < numWaveforms; ++w)
+    {
+        auto waveform = (Waveform) w;
+
+        // Start from the level with the fewest partials and work down, so each level
+        // only has to add the partials that the level above it left out.
+        int firstPartial = 1;
+
+        for (int level = numLevels - 1; level >= 0; --level)
+        {
+            auto* table = tables + ((size_t) w * numLevels + (size_t) level) * stride;
+            auto lastPartial = maxHarmonics >> level;
+
+            if (level < numLevels - 1)
+                std::memcpy (table, table + stride, sizeof (float) * (size_t) tableSize);
+
+            for (int n = firstPartial; n <= lastPartial; ++n)
+            {
+                bool isCosine;
+                auto amplitude = getPartialAmplitude (waveform, n, isCosine);
+
+                if (amplitude == 0.0f)
+                    continue;
+
+                auto offset = isCosine ? tableSize / 4 : 0;
+
+                for (int i = 0; i < tableSize; ++i)
+                    table[i] += amplitude * sineTable[(n * i + offset) & mask];
+            }
+
+            table[tableSize] = table[0];
+            firstPartial = lastPartial + 1;
+        }
+    }
+}
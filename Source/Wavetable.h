@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    Band-limited, mip-mapped wavetables for the synth's oscillators.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/** The waveforms the oscillator can produce. */
+enum class Waveform
+{
+    sine = 0,
+    square,
+    sawtooth,
+    triangle
+};
+
+static constexpr int numWaveforms = 4;
+
+/** Converts the waveform names used by the web UI ("sine", "square", "sawtooth",
+    "triangle") to a Waveform. Unknown names fall back to sine.
+*/
+Waveform waveformFromString (const juce::String& name);
+
+//==============================================================================
+/**
+    Holds a band-limited wavetable for every waveform at a number of mip levels.
+
+    Level 0 contains maxHarmonics partials and each level above it halves that,
+    so for any playback frequency there is a level whose highest partial stays
+    below Nyquist. The tables don't depend on the sample rate, so they only need
+    to be built once.
+*/
+class WavetableBank
+{
+public:
+    static constexpr int tableSize = 4096;
+    static constexpr int maxHarmonics = tableSize / 4;
+    static constexpr int numLevels = 11;    // 1024, 512, ... 1 partials
+
+    WavetableBank() = default;
+
+    /** Builds all of the tables. Does nothing if they've already been built.
+        This allocates, so it must not be called from the audio thread.
+    */
+    void build();
+
+    bool isBuilt() const noexcept       { return tables != nullptr; }
+
+    /** Returns the table for a waveform at the given mip level.
+        Each table holds tableSize + 1 samples: the last one repeats the first,
+        so linear interpolation never has to wrap the read index.
+    */
+    const float* getTable (Waveform waveform, int level) const noexcept
+    {
+        jassert (isBuilt() && juce::isPositiveAndBelow (level, numLevels));
+        return tables + ((size_t) waveform * numLevels + (size_t) level) * (size_t) (tableSize + 1);
+    }
+
+    /** Returns the mip level to use for a phase increment, given in cycles per sample. */
+    static int getLevelForIncrement (float cyclesPerSample) noexcept
+    {
+        int level = 0;
+
+        while (level < numLevels - 1 && (float) (maxHarmonics >> level) * cyclesPerSample >= 0.5f)
+            ++level;
+
+        return level;
+    }
+
+    /** Reads a table at a normalised phase in [0, 1) with linear interpolation. */
+    static float lookup (const float* table, float phase) noexcept
+    {
+        auto position = phase * (float) tableSize;
+        auto index = (int) position;
+        auto frac = position - (float) index;
+
+        return table[index] + frac * (table[index + 1] - table[index]);
+    }
+
+private:
+    juce::HeapBlock<float> tables;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WavetableBank)
+};
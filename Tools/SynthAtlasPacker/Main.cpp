@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    Packs each control's folder of animation frames into a single atlas image,
+    and writes a JSON index that the web UI uses to find the frames.
+
+    Usage: SynthAtlasPacker <frames folder> --output-dir <folder>
+
+    Every subfolder of the frames folder is one control, holding one PNG per
+    frame named <anything>_<number>.png. The frames are laid out left to right,
+    top to bottom, in a grid that's as close to square as they allow, so that
+    no atlas runs past the texture size limits the WebView has. The index,
+    atlases.json, looks like this:
+
+        { "atlases": { "knob_small_black": { "image": "knob_small_black.png",
+                                             "frames": 128, "frameWidth": 114, "frameHeight": 114,
+                                             "columns": 12, "rows": 11 }, ... } }
+
+    This is run by the build (see CMakeLists.txt), whenever a frame changes.
+
+  ==============================================================================
+*/
+
+#include <juce_graphics/juce_graphics.h>
+
+namespace
+{
+    /** Finds a control's frames in order. Files that don't end in a frame number, like the
+        "_008 (1).png" duplicates in some of the Blackway folders, are skipped.
+    */
+    std::vector<juce::File> findFrames (const juce::File& folder)
+    {
+        std::map<int, juce::File> frames;
+
+        for (auto& file : folder.findChildFiles (juce::File::findFiles, false, "*.png"))
+        {
+            auto number = file.getFileNameWithoutExtension().fromLastOccurrenceOf ("_", false, false);
+
+            if (number.isEmpty() || ! number.containsOnly ("0123456789"))
+            {
+                std::cerr << "Skipping " << file.getFullPathName() << std::endl;
+                continue;
+            }
+
+            if (! frames.emplace (number.getIntValue(), file).second)
+                std::cerr << "Skipping duplicate frame " << file.getFullPathName() << std::endl;
+        }
+
+        std::vector<juce::File> sorted;
+
+        for (auto& frame : frames)
+            sorted.push_back (frame.second);
+
+        return sorted;
+    }
+
+    juce::Image loadFrame (const juce::File& file)
+    {
+        auto image = juce::ImageFileFormat::loadFrom (file);
+
+        if (! image.isValid())
+            juce::ConsoleApplication::fail ("Couldn't load " + file.getFullPathName());
+
+        return image;
+    }
+
+    /** Packs one control's frames and returns its index entry. */
+    juce::var pack (const juce::File& folder, const juce::File& outputDirectory)
+    {
+        const auto frames = findFrames (folder);
+
+        if (frames.empty())
+            return {};
+
+        const auto first = loadFrame (frames.front());
+        const auto frameWidth = first.getWidth();
+        const auto frameHeight = first.getHeight();
+        const auto numFrames = (int) frames.size();
+
+        // Enough columns to make the atlas roughly square
+        const auto columns = juce::jlimit (1, numFrames, (int) std::ceil (std::sqrt ((double) numFrames * frameHeight / frameWidth)));
+        const auto rows = (numFrames + columns - 1) / columns;
+
+        juce::Image atlas (juce::Image::ARGB, columns * frameWidth, rows * frameHeight, true);
+
+        {
+            juce::Graphics g (atlas);
+
+            for (int i = 0; i < numFrames; ++i)
+            {
+                auto frame = i == 0 ? first : loadFrame (frames[(size_t) i]);
+
+                if (frame.getBounds() != first.getBounds())
+                    juce::ConsoleApplication::fail (frames[(size_t) i].getFullPathName() + " isn't the same size as the other frames");
+
+                g.drawImageAt (frame, (i % columns) * frameWidth, (i / columns) * frameHeight);
+            }
+        }
+
+        const auto name = folder.getFileName();
+        const auto imageFile = outputDirectory.getChildFile (name + ".png");
+
+        if (imageFile.existsAsFile() && ! imageFile.deleteFile())
+            juce::ConsoleApplication::fail ("Can't overwrite " + imageFile.getFullPathName());
+
+        juce::FileOutputStream stream (imageFile);
+        juce::PNGImageFormat png;
+
+        if (stream.failedToOpen() || ! png.writeImageToStream (atlas, stream))
+            juce::ConsoleApplication::fail ("Couldn't write " + imageFile.getFullPathName());
+
+        std::cout << name << ": " << numFrames << " frames of " << frameWidth << "x" << frameHeight
+                  << " in " << columns << "x" << rows << ", " << (stream.getPosition() / 1024) << " KB" << std::endl;
+
+        auto entry = new juce::DynamicObject();
+        entry->setProperty ("image", imageFile.getFileName());
+        entry->setProperty ("frames", numFrames);
+        entry->setProperty ("frameWidth", frameWidth);
+        entry->setProperty ("frameHeight", frameHeight);
+        entry->setProperty ("columns", columns);
+        entry->setProperty ("rows", rows);
+        return entry;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args.containsOption ("--help|-h"))
+    {
+        std::cout << "Usage: " << args.executableName << " <frames folder> --output-dir <folder>" << std::endl;
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        auto inputDirectory = args[0].resolveAsExistingFolder();
+        auto outputDirectory = args.getFileForOption ("--output-dir");
+
+        if (! outputDirectory.createDirectory())
+            juce::ConsoleApplication::fail ("Can't create " + outputDirectory.getFullPathName());
+
+        auto folders = inputDirectory.findChildFiles (juce::File::findDirectories, false);
+        folders.sort();
+
+        auto atlases = new juce::DynamicObject();
+
+        for (auto& folder : folders)
+        {
+            auto entry = pack (folder, outputDirectory);
+
+            if (! entry.isVoid())
+                atlases->setProperty (folder.getFileName(), entry);
+        }
+
+        auto index = new juce::DynamicObject();
+        index->setProperty ("atlases", atlases);
+
+        // Written last, so the build only sees it once every atlas is in place
+        auto indexFile = outputDirectory.getChildFile ("atlases.json");
+
+        if (! indexFile.replaceWithText (juce::JSON::toString (index)))
+            juce::ConsoleApplication::fail ("Couldn't write " + indexFile.getFullPathName());
+
+        return 0;
+    });
+}
@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    Measures the cost of SynthEngine::renderBlock(), the code the audio
+    callback runs, across block sizes, sample rates, waveforms and voice counts.
+
+    Usage: SynthBenchmark [--block-sizes 32,64,...] [--sample-rates 44100,...]
+                          [--waveforms sine,...] [--voices 1,8,...] [--unison 1,7]
+                          [--paths simd,scalar] [--render-threads 0,3] [--oversampling 1,4]
+                          [--seconds 0.5] [--output results.json]
+
+    Results are written as JSON, to the --output file or to stdout, with one
+    entry per configuration:
+     - nsPerSample:         wall time per output sample
+     - nsPerVoiceSample:    the same, divided by the number of voices
+     - realtimeFactor:      seconds of audio rendered per second of CPU
+     - blockMicroseconds:   p50, p99, p999 and max time for a single block
+     - deadlineMicroseconds: how long a block lasts at that sample rate
+
+  ==============================================================================
+*/
+
+#include "SynthEngine.h"
+
+namespace
+{
+    struct Configuration
+    {
+        int blockSize;
+        double sampleRate;
+        Waveform waveform;
+        int numVoices;
+        int unison;
+        SynthEngine::RenderPath path;
+        int renderThreads;
+        int oversampling;
+    };
+
+    juce::StringArray getList (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaults)
+    {
+        auto list = args.containsOption (option) ? args.getValueForOption (option) : defaults;
+        return juce::StringArray::fromTokens (list, ",", {});
+    }
+
+    const char* getWaveformName (Waveform w)
+    {
+        switch (w)
+        {
+            case Waveform::sine:      return "sine";
+            case Waveform::square:    return "square";
+            case Waveform::sawtooth:  return "sawtooth";
+            case Waveform::triangle:  return "triangle";
+        }
+
+        return "";
+    }
+
+    double getPercentile (const std::vector<double>& sorted, double percentile)
+    {
+        auto index = (size_t) std::ceil (percentile / 100.0 * (double) sorted.size());
+        return sorted[juce::jlimit ((size_t) 0, sorted.size() - 1, index == 0 ? 0 : index - 1)];
+    }
+
+    juce::var run (const Configuration& config, double secondsToRender)
+    {
+        SynthEngine engine;
+        engine.setEventTiming (SynthEngine::EventTiming::nextBlock);
+        engine.setRenderPath (config.path);
+        engine.setNumRenderThreads (config.renderThreads);
+        engine.setOversampling (config.oversampling);
+
+        // Notes that hold at full level for the whole run, so every voice costs the same throughout
+        auto& parameters = engine.getParameters();
+        parameters.set (ParameterID::attack, 0.0f);
+        parameters.set (ParameterID::sustain, 1.0f);
+        parameters.set (ParameterID::detune, 15.0f);
+
+        engine.prepare (config.sampleRate, config.blockSize);
+        engine.setWaveform (config.waveform);
+        engine.setUnisonVoices (config.unison);
+
+        for (int i = 0; i < config.numVoices; ++i)
+        {
+            auto note = 36 + (i * 7) % 60;      // spread across five octaves
+            engine.noteOn (i, juce::MidiMessage::getMidiNoteInHertz (note), 0.5f);
+        }
+
+        juce::AudioBuffer<float> buffer (SynthEngine::numOutputChannels, config.blockSize);
+        auto* const* channels = buffer.getArrayOfWritePointers();
+
+        // Warm up the caches and let the first events land
+        for (int i = 0; i < juce::jmax (4, (int) (0.1 * config.sampleRate) / config.blockSize); ++i)
+            engine.process (channels, config.blockSize);
+
+        jassert (engine.getNumActiveVoices() == config.numVoices);
+
+        const auto numBlocks = juce::jmax (16, (int) (secondsToRender * config.sampleRate) / config.blockSize);
+        std::vector<double> blockSeconds ((size_t) numBlocks);
+
+        for (auto& seconds : blockSeconds)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            engine.process (channels, config.blockSize);
+            seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        }
+
+        const auto totalSeconds = std::accumulate (blockSeconds.begin(), blockSeconds.end(), 0.0);
+        const auto numSamples = (double) numBlocks * config.blockSize;
+        const auto nsPerSample = totalSeconds * 1.0e9 / numSamples;
+
+        std::sort (blockSeconds.begin(), blockSeconds.end());
+
+        auto blockTimes = new juce::DynamicObject();
+        blockTimes->setProperty ("p50", getPercentile (blockSeconds, 50.0) * 1.0e6);
+        blockTimes->setProperty ("p99", getPercentile (blockSeconds, 99.0) * 1.0e6);
+        blockTimes->setProperty ("p999", getPercentile (blockSeconds, 99.9) * 1.0e6);
+        blockTimes->setProperty ("max", blockSeconds.back() * 1.0e6);
+
+        auto result = new juce::DynamicObject();
+        result->setProperty ("blockSize", config.blockSize);
+        result->setProperty ("sampleRate", config.sampleRate);
+        result->setProperty ("waveform", getWaveformName (config.waveform));
+        result->setProperty ("voices", config.numVoices);
+        result->setProperty ("unison", config.unison);
+        result->setProperty ("path", config.path == SynthEngine::RenderPath::simd ? "simd" : "scalar");
+        result->setProperty ("renderThreads", config.renderThreads);
+        result->setProperty ("oversampling", config.oversampling);
+        result->setProperty ("blocks", numBlocks);
+        result->setProperty ("nsPerSample", nsPerSample);
+        result->setProperty ("nsPerVoiceSample", nsPerSample / juce::jmax (1, config.numVoices));
+        result->setProperty ("realtimeFactor", numSamples / config.sampleRate / totalSeconds);
+        result->setProperty ("blockMicroseconds", blockTimes);
+        result->setProperty ("deadlineMicroseconds", config.blockSize / config.sampleRate * 1.0e6);
+        return result;
+    }
+
+    juce::var getMachineInfo()
+    {
+        auto info = new juce::DynamicObject();
+        info->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        info->setProperty ("cpuVendor", juce::SystemStats::getCpuVendor());
+        info->setProperty ("numCpus", juce::SystemStats::getNumCpus());
+        info->setProperty ("numPhysicalCpus", juce::SystemStats::getNumPhysicalCpus());
+        info->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+        info->setProperty ("juce", juce::SystemStats::getJUCEVersion());
+        info->setProperty ("simd", VoiceRenderer::isSIMDAvailable());
+        info->setProperty ("simdLanes", (int) juce::dsp::SIMDRegister<float>::size());
+        info->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+        return info;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        std::cout << "Usage: " << args.executableName
+                  << " [--block-sizes 32,64,...] [--sample-rates 44100,...] [--waveforms sine,...]"
+                     " [--voices 1,8,...] [--unison 1,7] [--paths simd,scalar] [--render-threads 0,3]"
+                     " [--oversampling 1,4] [--seconds 0.5] [--output results.json]"
+                  << std::endl;
+        return 0;
+    }
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        const auto blockSizes  = getList (args, "--block-sizes", "32,64,128,256,512,1024,2048");
+        const auto sampleRates = getList (args, "--sample-rates", "44100,48000,88200,96000,176400,192000");
+        const auto waveforms   = getList (args, "--waveforms", "sine,square,sawtooth,triangle");
+        const auto voiceCounts = getList (args, "--voices", "1,8,32,64");
+        const auto unisonSizes = getList (args, "--unison", "1");
+        const auto paths       = getList (args, "--paths", "simd");
+        const auto threads     = getList (args, "--render-threads", "0");
+        const auto factors     = getList (args, "--oversampling", "1");
+        const auto seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : 0.5;
+
+        std::vector<Configuration> configurations;
+
+        for (auto& factor : factors)
+            for (auto& renderThreads : threads)
+                for (auto& path : paths)
+                    for (auto& unison : unisonSizes)
+                        for (auto& voices : voiceCounts)
+                            for (auto& waveform : waveforms)
+                                for (auto& sampleRate : sampleRates)
+                                    for (auto& blockSize : blockSizes)
+                                        configurations.push_back ({ juce::jlimit (1, 8192, blockSize.getIntValue()),
+                                                                    juce::jlimit (8000.0, 768000.0, sampleRate.getDoubleValue()),
+                                                                    waveformFromString (waveform),
+                                                                    juce::jlimit (0, VoicePool::maxVoices, voices.getIntValue()),
+                                                                    juce::jlimit (1, VoicePool::maxUnison, unison.getIntValue()),
+                                                                    path == "scalar" ? SynthEngine::RenderPath::scalar
+                                                                                     : SynthEngine::RenderPath::simd,
+                                                                    juce::jlimit (0, SynthEngine::maxRenderThreads, renderThreads.getIntValue()),
+                                                                    juce::jlimit (1, SynthEngine::maxOversampling,
+                                                                                  juce::nextPowerOfTwo (factor.getIntValue())) });
+
+        juce::Array<juce::var> results;
+
+        for (size_t i = 0; i < configurations.size(); ++i)
+        {
+            const auto& c = configurations[i];
+            std::cerr << "[" << (i + 1) << "/" << configurations.size() << "] "
+                      << getWaveformName (c.waveform) << ", " << c.numVoices << " voices x " << c.unison
+                      << ", " << c.blockSize << " samples at " << c.sampleRate << " Hz"
+                      << (c.renderThreads > 0 ? ", " + std::to_string (c.renderThreads) + " render threads" : std::string())
+                      << (c.oversampling > 1 ? ", " + std::to_string (c.oversampling) + "x oversampling" : std::string())
+                      << std::endl;
+
+            results.add (run (c, seconds));
+        }
+
+        auto report = new juce::DynamicObject();
+        report->setProperty ("machine", getMachineInfo());
+        report->setProperty ("results", results);
+
+        auto json = juce::JSON::toString (report);
+
+        if (args.containsOption ("--output"))
+        {
+            auto file = args.getFileForOption ("--output");
+
+            if (! file.replaceWithText (json))
+                juce::ConsoleApplication::fail ("Couldn't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+
+        return 0;
+    });
+}
@@ -0,0 +1,434 @@
+/*
+  ==============================================================================
+
+    Checks the engine's output against golden renders, so changes to the DSP
+    code that alter the sound are caught, and ones that don't can be trusted.
+
+    Usage: SynthGolden <script.json> [--golden-dir <folder>] [--update]
+                       [--paths simd,scalar] [--render-threads 0,3]
+                       [--exact] [--failures <folder>]
+
+    Every job in the script (see RenderScript.h) is rendered through
+    SynthEngine::renderBlock(), the code the audio callback runs, and compared
+    with the 32-bit float WAV of the same name in the golden folder, which
+    defaults to the script's own. Each job is rendered on the SIMD path on one
+    thread, then with every other combination of --paths and --render-threads,
+    and each of those has to match the same file.
+
+    Three things are measured for each render:
+     - bit-exact:           whether every sample is identical
+     - max abs error:       the largest difference between any two samples
+     - spectral difference: the energy of the difference between the two
+                            magnitude spectrograms, relative to the golden one's,
+                            in dB. Phase is left out, so it's a measure of how
+                            different they sound.
+
+    A render passes if it's bit-exact or, unless --exact is given, if its max abs
+    error and spectral difference are within the script's "maxAbsError" and
+    "maxSpectralDifference" (in dB), which a job can override for itself.
+
+    --update writes new golden files from the SIMD path on one thread, before
+    checking the rest against them. --failures writes each render that fails, to
+    listen to or diff. It returns 1 if anything fails.
+
+    Nothing is read from or sent to an audio device, the clock or the network,
+    so a render only depends on the script and the code.
+
+  ==============================================================================
+*/
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "RenderScript.h"
+
+namespace
+{
+    /** Golden files are floats, so they hold exactly what the engine made. */
+    constexpr int goldenBitDepth = 32;
+
+    /** Spectrogram frame size, as a power of two, and the frame step. */
+    constexpr int fftOrder = 11;
+    constexpr int fftSize = 1 << fftOrder;
+    constexpr int fftHop = fftSize / 2;
+
+    constexpr double defaultMaxAbsError = 1.0e-4;
+    constexpr double defaultMaxSpectralDifference = -60.0;     // dB
+
+    void log (const juce::String& message)
+    {
+        std::cout << message << std::endl;
+    }
+
+    juce::StringArray getList (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaults)
+    {
+        auto list = args.containsOption (option) ? args.getValueForOption (option) : defaults;
+        return juce::StringArray::fromTokens (list, ",", {});
+    }
+
+    //==============================================================================
+    struct Configuration
+    {
+        SynthEngine::RenderPath path;
+        int renderThreads;
+
+        juce::String getName() const
+        {
+            return juce::String (path == SynthEngine::RenderPath::simd ? "simd" : "scalar")
+                     + ", " + juce::String (renderThreads) + " render threads";
+        }
+    };
+
+    struct Tolerance
+    {
+        double maxAbsError = defaultMaxAbsError;
+        double maxSpectralDifference = defaultMaxSpectralDifference;
+    };
+
+    struct Comparison
+    {
+        bool lengthsMatch = true;
+        bool bitExact = true;
+        juce::int64 firstDifference = -1;          // the first sample that differs, if any
+        double maxAbsError = 0.0;
+        double spectralDifference = -std::numeric_limits<double>::infinity();
+
+        bool passes (const Tolerance& tolerance, bool exactOnly) const
+        {
+            if (! lengthsMatch)
+                return false;
+
+            if (bitExact)
+                return true;
+
+            return ! exactOnly
+                    && maxAbsError <= tolerance.maxAbsError
+                    && spectralDifference <= tolerance.maxSpectralDifference;
+        }
+
+        juce::String getDescription() const
+        {
+            if (! lengthsMatch)
+                return "lengths differ";
+
+            if (bitExact)
+                return "bit-exact";
+
+            return "first difference at sample " + juce::String (firstDifference)
+                     + ", max abs error " + juce::String (maxAbsError, 8)
+                     + " (" + juce::String (juce::Decibels::gainToDecibels (maxAbsError, -300.0), 1) + " dB)"
+                     + ", spectral difference " + juce::String (spectralDifference, 1) + " dB";
+        }
+    };
+
+    //==============================================================================
+    /** Accumulates the energy of the golden spectrogram, and of its difference from
+        the rendered one, one channel at a time.
+    */
+    class SpectralDifference
+    {
+    public:
+        void addChannel (const float* rendered, const float* golden, int numSamples)
+        {
+            for (int start = 0; start < numSamples; start += fftHop)
+            {
+                const auto length = juce::jmin (fftSize, numSamples - start);
+
+                getMagnitudes (rendered + start, length, renderedFrame);
+                getMagnitudes (golden + start, length, goldenFrame);
+
+                for (int bin = 0; bin <= fftSize / 2; ++bin)
+                {
+                    const auto difference = (double) renderedFrame[(size_t) bin] - goldenFrame[(size_t) bin];
+                    differenceEnergy += difference * difference;
+                    goldenEnergy += (double) goldenFrame[(size_t) bin] * goldenFrame[(size_t) bin];
+                }
+            }
+        }
+
+        /** The difference relative to the golden spectrogram, in dB. Against silence,
+            any difference at all counts as 0 dB.
+        */
+        double getDecibels() const
+        {
+            if (differenceEnergy <= 0.0)
+                return -std::numeric_limits<double>::infinity();
+
+            if (goldenEnergy <= 0.0)
+                return 0.0;
+
+            return 10.0 * std::log10 (differenceEnergy / goldenEnergy);
+        }
+
+    private:
+        void getMagnitudes (const float* samples, int length, std::vector<float>& frame)
+        {
+            // The last frame is padded with zeros
+            std::fill (frame.begin(), frame.end(), 0.0f);
+            std::copy (samples, samples + length, frame.begin());
+
+            window.multiplyWithWindowingTable (frame.data(), (size_t) fftSize);
+            fft.performFrequencyOnlyForwardTransform (frame.data(), true);
+        }
+
+        juce::dsp::FFT fft { fftOrder };
+        juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+
+        // The transform works in place, and needs twice the frame size to do it
+        std::vector<float> renderedFrame = std::vector<float> (2 * fftSize);
+        std::vector<float> goldenFrame = std::vector<float> (2 * fftSize);
+
+        double differenceEnergy = 0.0, goldenEnergy = 0.0;
+    };
+
+    Comparison compare (const juce::AudioBuffer<float>& rendered, const juce::AudioBuffer<float>& golden)
+    {
+        Comparison result;
+
+        if (rendered.getNumChannels() != golden.getNumChannels() || rendered.getNumSamples() != golden.getNumSamples())
+        {
+            result.lengthsMatch = false;
+            result.bitExact = false;
+            return result;
+        }
+
+        SpectralDifference spectrum;
+
+        for (int channel = 0; channel < golden.getNumChannels(); ++channel)
+        {
+            const auto* r = rendered.getReadPointer (channel);
+            const auto* g = golden.getReadPointer (channel);
+
+            for (int i = 0; i < golden.getNumSamples(); ++i)
+            {
+                // Compared as bits, so a NaN or a change of sign on zero still counts
+                if (std::memcmp (r + i, g + i, sizeof (float)) != 0)
+                {
+                    result.bitExact = false;
+
+                    if (result.firstDifference < 0 || i < result.firstDifference)
+                        result.firstDifference = i;
+                }
+
+                const auto error = std::abs ((double) r[i] - g[i]);
+                result.maxAbsError = std::isnan (error) ? std::numeric_limits<double>::infinity()
+                                                        : juce::jmax (result.maxAbsError, error);
+            }
+
+            spectrum.addChannel (r, g, golden.getNumSamples());
+        }
+
+        result.spectralDifference = result.bitExact ? -std::numeric_limits<double>::infinity()
+                                                    : spectrum.getDecibels();
+        return result;
+    }
+
+    //==============================================================================
+    /** Renders a whole job into memory. Returns an error message, or an empty string. */
+    juce::String render (const RenderJob& job, juce::AudioBuffer<float>& output)
+    {
+        if (job.lengthInSamples > std::numeric_limits<int>::max())
+            return "too long to hold in memory";
+
+        output.setSize (SynthEngine::numOutputChannels, (int) job.lengthInSamples);
+        int position = 0;
+
+        auto rendered = job.render ([&output, &position] (const float* const* channels, int numSamples)
+        {
+            for (int channel = 0; channel < output.getNumChannels(); ++channel)
+                output.copyFrom (channel, position, channels[channel], numSamples);
+
+            position += numSamples;
+            return true;
+        });
+
+        return rendered ? juce::String() : "the render failed";
+    }
+
+    juce::String writeWav (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        if (! file.getParentDirectory().createDirectory() || (file.existsAsFile() && ! file.deleteFile()))
+            return "can't write to " + file.getFullPathName();
+
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            return "can't open " + file.getFullPathName();
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate,
+                                                                              (unsigned int) buffer.getNumChannels(),
+                                                                              goldenBitDepth, {}, 0));
+        if (writer == nullptr)
+            return "can't create a WAV writer";
+
+        stream.release();   // the writer owns it now
+
+        if (! writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples()))
+            return "writing " + file.getFullPathName() + " failed";
+
+        return {};
+    }
+
+    juce::String readWav (const juce::File& file, double expectedSampleRate, juce::AudioBuffer<float>& buffer)
+    {
+        if (! file.existsAsFile())
+            return "there's no golden file " + file.getFullPathName() + " (run with --update to make one)";
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader (wav.createReaderFor (file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return "can't read " + file.getFullPathName();
+
+        if (reader->bitsPerSample != goldenBitDepth || ! reader->usesFloatingPointData)
+            return file.getFileName() + " isn't a 32-bit float WAV";
+
+        if (reader->sampleRate != expectedSampleRate)
+            return file.getFileName() + " is at " + juce::String (reader->sampleRate) + " Hz, but the job is at "
+                     + juce::String (expectedSampleRate) + " Hz";
+
+        if (reader->lengthInSamples > std::numeric_limits<int>::max())
+            return file.getFileName() + " is too long";
+
+        buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+        return {};
+    }
+
+    /** Reads a setting from a job in the script, falling back to the top level and then to a default. */
+    double getSetting (const juce::var& script, int jobIndex, const juce::Identifier& name, double defaultValue)
+    {
+        const auto& job = script["jobs"][jobIndex];
+        return job.hasProperty (name) ? (double) job[name] : (double) script.getProperty (name, defaultValue);
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args.containsOption ("--help|-h"))
+    {
+        log ("Usage: " + args.executableName + " <script.json> [--golden-dir <folder>] [--update]"
+               " [--paths simd,scalar] [--render-threads 0,3] [--exact] [--failures <folder>]");
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    // Missing files and bad options throw, and are reported here
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        auto scriptFile = args[0].resolveAsExistingFile();
+        juce::var script;
+        auto result = juce::JSON::parse (scriptFile.loadFileAsString(), script);
+
+        std::vector<RenderJob> jobs;
+
+        if (result.wasOk())
+            result = RenderScript::parse (script, jobs);
+
+        if (result.failed())
+            juce::ConsoleApplication::fail (scriptFile.getFileName() + ": " + result.getErrorMessage());
+
+        // Sample folders and impulse responses are relative to the script, as in SynthRender
+        for (auto& job : jobs)
+        {
+            if (job.samples.isNotEmpty())
+                job.sampleFolder = scriptFile.getParentDirectory().getChildFile (job.samples);
+
+            if (job.impulseResponse.isNotEmpty())
+                job.impulseResponseFile = scriptFile.getParentDirectory().getChildFile (job.impulseResponse);
+        }
+
+        // The reference configuration comes first, as it's the one --update writes
+        std::vector<Configuration> configurations { { SynthEngine::RenderPath::simd, 0 } };
+
+        for (const auto& path : getList (args, "--paths", "simd,scalar"))
+        {
+            if (path != "simd" && path != "scalar")
+                juce::ConsoleApplication::fail ("--paths can only list simd and scalar");
+
+            for (const auto& threads : getList (args, "--render-threads", "0,3"))
+            {
+                const Configuration c { path == "scalar" ? SynthEngine::RenderPath::scalar : SynthEngine::RenderPath::simd,
+                                        juce::jlimit (0, SynthEngine::maxRenderThreads, threads.getIntValue()) };
+
+                if (c.path != configurations.front().path || c.renderThreads != configurations.front().renderThreads)
+                    configurations.push_back (c);
+            }
+        }
+
+        const auto goldenDirectory = args.containsOption ("--golden-dir") ? args.getFileForOption ("--golden-dir")
+                                                                           : scriptFile.getParentDirectory();
+        const auto update = args.containsOption ("--update");
+        const auto exactOnly = args.containsOption ("--exact");
+
+        int numChecked = 0, numFailed = 0;
+
+        for (int i = 0; i < (int) jobs.size(); ++i)
+        {
+            auto& job = jobs[(size_t) i];
+            const auto goldenFile = goldenDirectory.getChildFile (job.output).withFileExtension ("wav");
+            const Tolerance tolerance { getSetting (script, i, "maxAbsError", defaultMaxAbsError),
+                                        getSetting (script, i, "maxSpectralDifference", defaultMaxSpectralDifference) };
+
+            if (update)
+            {
+                juce::AudioBuffer<float> reference;
+                auto error = render (job, reference);
+
+                if (error.isEmpty())
+                    error = writeWav (goldenFile, reference, job.sampleRate);
+
+                if (error.isNotEmpty())
+                    juce::ConsoleApplication::fail (job.name + ": " + error);
+
+                log (job.name + ": wrote " + goldenFile.getFullPathName());
+            }
+
+            juce::AudioBuffer<float> golden;
+
+            if (auto error = readWav (goldenFile, job.sampleRate, golden); error.isNotEmpty())
+            {
+                log ("FAIL " + job.name + ": " + error);
+                numChecked += (int) configurations.size();
+                numFailed += (int) configurations.size();
+                continue;
+            }
+
+            for (const auto& configuration : configurations)
+            {
+                job.renderPath = configuration.path;
+                job.renderThreads = configuration.renderThreads;
+
+                juce::AudioBuffer<float> rendered;
+                const auto error = render (job, rendered);
+                const auto comparison = compare (rendered, golden);
+                const auto passed = error.isEmpty() && comparison.passes (tolerance, exactOnly);
+
+                log ((passed ? "pass " : "FAIL ") + job.name + " (" + configuration.getName() + "): "
+                       + (error.isNotEmpty() ? error : comparison.getDescription()));
+
+                ++numChecked;
+
+                if (passed)
+                    continue;
+
+                ++numFailed;
+
+                if (args.containsOption ("--failures") && error.isEmpty())
+                {
+                    const auto failureFile = args.getFileForOption ("--failures")
+                                                 .getChildFile (goldenFile.getFileNameWithoutExtension() + "-"
+                                                                  + configuration.getName().removeCharacters (",").replaceCharacter (' ', '-')
+                                                                  + ".wav");
+
+                    if (auto writeError = writeWav (failureFile, rendered, job.sampleRate); writeError.isNotEmpty())
+                        log ("  " + writeError);
+                }
+            }
+        }
+
+        log (juce::String (numChecked - numFailed) + " of " + juce::String (numChecked) + " renders match their golden files");
+        return numFailed > 0 ? 1 : 0;
+    });
+}
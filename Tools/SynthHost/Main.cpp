@@ -0,0 +1,302 @@
+/*
+  ==============================================================================
+
+    Runs several independent synth engines in one process, on one audio device.
+
+    Usage: SynthHost [--instances N] [--routing channel|port] [--samples <folder>]
+                     [--render-threads N] [--oversampling 1|2|4|8]
+
+    Each instance is a SynthEngine with its own voices and effects. It plays one
+    MIDI channel (instance 1 plays channel 1, and so on) or, with --routing port,
+    one MIDI input device, in the order the devices are listed at startup.
+    Instance n plays into output channels 2n - 1 and 2n; if the device has fewer
+    outputs than that, the instances wrap around and share them.
+
+    The wavetables and filter table are built once and shared by every instance,
+    as is the --samples library, which is mapped once and handed to them all.
+    There's no UI, so the web UI's files aren't loaded at all. What's left per
+    instance is its voices, buffers and effects.
+
+    Instances are rendered in parallel on a RenderWorkerPool, one task each, with
+    the audio thread taking tasks too. It runs until it's interrupted.
+
+  ==============================================================================
+*/
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include "SynthEngine.h"
+
+namespace
+{
+    constexpr int maxInstances = 16;
+
+    void log (const juce::String& message)
+    {
+        std::cout << message << std::endl;
+    }
+
+    enum class MidiRouting
+    {
+        channel,
+        port
+    };
+
+    //==============================================================================
+    class SynthHost  : public juce::AudioIODeviceCallback,
+                       private juce::MidiInputCallback,
+                       private juce::Timer
+    {
+    public:
+        SynthHost (int numInstances, MidiRouting routing, int numRenderThreads, int oversampling)
+            : midiRouting (routing), renderThreads (numRenderThreads)
+        {
+            for (int i = 0; i < numInstances; ++i)
+            {
+                auto engine = std::make_unique<SynthEngine>();
+                engine->setOversampling (oversampling);
+                instances.push_back (std::move (engine));
+            }
+        }
+
+        ~SynthHost() override
+        {
+            stopTimer();
+            deviceManager.removeMidiInputDeviceCallback ({}, this);
+            deviceManager.removeAudioCallback (this);
+        }
+
+        /** Hands one library to every instance and switches them all to samples. */
+        void loadSamples (const std::shared_ptr<const SampleLibrary>& library)
+        {
+            for (auto& engine : instances)
+            {
+                engine->loadSamples (library);
+                engine->setOscillatorType (OscillatorType::sample);
+            }
+        }
+
+        /** Opens the default audio device, with an output pair per instance if it has
+            them, and every MIDI input. Returns an error message, or an empty string.
+        */
+        juce::String start()
+        {
+            auto error = deviceManager.initialise (0, 2 * (int) instances.size(), nullptr, true);
+
+            if (error.isNotEmpty())
+                return error;
+
+            // Listed before the callback is added, so it's only ever read after this
+            for (const auto& device : juce::MidiInput::getAvailableDevices())
+            {
+                deviceManager.setMidiInputDeviceEnabled (device.identifier, true);
+                midiPorts.add (device.identifier);
+                log ("MIDI input " + juce::String (midiPorts.size()) + ": " + device.name);
+            }
+
+            deviceManager.addMidiInputDeviceCallback ({}, this);
+            deviceManager.addAudioCallback (this);
+            startTimer (5000);
+            return {};
+        }
+
+        juce::String getDeviceDescription() const
+        {
+            auto* device = deviceManager.getCurrentAudioDevice();
+
+            if (device == nullptr)
+                return "no audio device";
+
+            return device->getName() + ", " + juce::String (device->getActiveOutputChannels().countNumberOfSetBits())
+                     + " outputs at " + juce::String (device->getCurrentSampleRate()) + " Hz";
+        }
+
+        //==============================================================================
+        void audioDeviceAboutToStart (juce::AudioIODevice* device) override
+        {
+            sampleRate = device->getCurrentSampleRate();
+            const auto blockSize = device->getCurrentBufferSizeSamples();
+
+            for (auto& engine : instances)
+                engine->prepare (sampleRate, blockSize);
+
+            instanceOutputs.setSize (2 * (int) instances.size(), blockSize);
+
+            workers.reset();
+
+            if (renderThreads > 0 && instances.size() > 1)
+                workers = std::make_unique<RenderWorkerPool> (renderThreads, blockSize, sampleRate);
+        }
+
+        void audioDeviceStopped() override {}
+
+        void audioDeviceIOCallbackWithContext (const float* const*, int,
+                                               float* const* outputChannelData, int numOutputChannels, int numSamples,
+                                               const juce::AudioIODeviceCallbackContext& context) override
+        {
+            for (int channel = 0; channel < numOutputChannels; ++channel)
+                juce::FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+
+            const auto numInstances = (int) instances.size();
+            auto* const* outputs = instanceOutputs.getArrayOfWritePointers();
+
+            // Devices can hand over more than they said they would, so render in pieces if need be
+            for (int start = 0; start < numSamples;)
+            {
+                job.outputs = outputs;
+                job.numSamples = juce::jmin (numSamples - start, instanceOutputs.getNumSamples());
+                job.hasTime = context.hostTimeNs != nullptr;
+
+                if (job.hasTime)
+                    job.timeNs = *context.hostTimeNs + (uint64_t) ((double) start * 1.0e9 / sampleRate);
+
+                if (workers != nullptr)
+                {
+                    workers->run (renderInstance, this, numInstances);
+                }
+                else
+                {
+                    for (int i = 0; i < numInstances; ++i)
+                        renderInstance (this, i);
+                }
+
+                if (numOutputChannels > 0)
+                {
+                    for (int channel = 0; channel < 2 * numInstances; ++channel)
+                        juce::FloatVectorOperations::add (outputChannelData[channel % numOutputChannels] + start,
+                                                          outputs[channel], job.numSamples);
+                }
+
+                start += job.numSamples;
+            }
+        }
+
+    private:
+        //==============================================================================
+        struct RenderJob
+        {
+            float* const* outputs = nullptr;
+            int numSamples = 0;
+            bool hasTime = false;
+            uint64_t timeNs = 0;
+        };
+
+        static void renderInstance (void* context, int index) noexcept
+        {
+            auto& host = *static_cast<SynthHost*> (context);
+            const auto& job = host.job;
+
+            float* const bus[] = { job.outputs[2 * index], job.outputs[2 * index + 1] };
+            host.instances[(size_t) index]->renderBlock (bus, 2, job.numSamples, job.hasTime ? &job.timeNs : nullptr);
+        }
+
+        void handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message) override
+        {
+            // AudioDeviceManager calls this with a lock held, so each engine only ever has one thread posting to it
+            const auto instance = midiRouting == MidiRouting::port
+                                      ? (source != nullptr ? midiPorts.indexOf (source->getIdentifier()) : -1)
+                                      : message.getChannel() - 1;
+
+            if (juce::isPositiveAndBelow (instance, (int) instances.size()))
+                instances[(size_t) instance]->postMidiMessage (message);
+        }
+
+        void timerCallback() override
+        {
+            juce::StringArray voices;
+
+            for (auto& engine : instances)
+            {
+                engine->releaseRetiredSnapshots();
+                voices.add (juce::String (engine->getNumActiveVoices()));
+            }
+
+            log ("Voices per instance: " + voices.joinIntoString (" "));
+        }
+
+        //==============================================================================
+        const MidiRouting midiRouting;
+        const int renderThreads;
+
+        std::vector<std::unique_ptr<SynthEngine>> instances;
+        juce::StringArray midiPorts;
+        juce::AudioDeviceManager deviceManager;
+
+        // Only touched by the audio thread and, during a render, the workers
+        std::unique_ptr<RenderWorkerPool> workers;
+        juce::AudioBuffer<float> instanceOutputs;       // a stereo pair per instance
+        RenderJob job;
+        double sampleRate = 44100.0;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SynthHost)
+    };
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        log ("Usage: " + args.executableName + " [--instances N] [--routing channel|port] [--samples <folder>]"
+               " [--render-threads N] [--oversampling 1|2|4|8]");
+        return 0;
+    }
+
+    // Bad options throw, and are reported here
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        const auto numInstances = args.containsOption ("--instances") ? args.getValueForOption ("--instances").getIntValue() : 4;
+
+        if (numInstances < 1 || numInstances > maxInstances)
+            juce::ConsoleApplication::fail ("--instances must be between 1 and " + juce::String (maxInstances));
+
+        auto routing = MidiRouting::channel;
+
+        if (args.containsOption ("--routing"))
+        {
+            const auto name = args.getValueForOption ("--routing");
+
+            if (name != "channel" && name != "port")
+                juce::ConsoleApplication::fail ("--routing must be channel or port");
+
+            routing = name == "port" ? MidiRouting::port : MidiRouting::channel;
+        }
+
+        const auto oversampling = args.containsOption ("--oversampling") ? args.getValueForOption ("--oversampling").getIntValue() : 2;
+
+        if (oversampling != 1 && oversampling != 2 && oversampling != 4 && oversampling != 8)
+            juce::ConsoleApplication::fail ("--oversampling must be 1, 2, 4 or 8");
+
+        // By default, one worker per instance beyond the first, as far as the cores go
+        const auto renderThreads = args.containsOption ("--render-threads")
+                                       ? args.getValueForOption ("--render-threads").getIntValue()
+                                       : juce::jmin (numInstances, juce::SystemStats::getNumCpus()) - 1;
+
+        SynthHost host (numInstances, routing, juce::jmax (0, renderThreads), oversampling);
+
+        if (args.containsOption ("--samples"))
+        {
+            juce::String error;
+            std::shared_ptr<const SampleLibrary> library = SampleLibrary::loadDirectory (args.getExistingFolderForOption ("--samples"), error);
+
+            if (library == nullptr)
+                juce::ConsoleApplication::fail ("can't load the samples: " + error);
+
+            log ("Loaded " + juce::String (library->getNumZones()) + " samples from " + library->getName()
+                   + ", shared by every instance");
+            host.loadSamples (library);
+        }
+
+        if (auto error = host.start(); error.isNotEmpty())
+            juce::ConsoleApplication::fail ("can't open the audio device: " + error);
+
+        log ("Running " + juce::String (numInstances) + " instances on " + host.getDeviceDescription()
+               + (routing == MidiRouting::port ? ", one MIDI input each" : ", one MIDI channel each"));
+
+        juce::MessageManager::getInstance()->runDispatchLoop();
+        return 0;
+    });
+}
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    Renders JSON note scripts to audio files offline, without an audio device.
+
+    Usage: SynthRender <script.json> [--threads N] [--output-dir <folder>]
+                       [--oversampling 1|2|4|8]
+
+    Each job in the script is rendered on its own thread, as fast as the CPU
+    allows, and streamed straight to a WAV or FLAC file (chosen by the output
+    file's extension). See RenderScript.h for the script format. --oversampling
+    overrides the quality the script asks for, for every job.
+
+  ==============================================================================
+*/
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "RenderScript.h"
+
+namespace
+{
+    juce::CriticalSection consoleLock;
+
+    void log (const juce::String& message)
+    {
+        const juce::ScopedLock sl (consoleLock);
+        std::cout << message << std::endl;
+    }
+
+    std::unique_ptr<juce::AudioFormat> createFormatFor (const juce::File& file)
+    {
+        if (file.hasFileExtension ("flac"))
+            return std::make_unique<juce::FlacAudioFormat>();
+
+        return std::make_unique<juce::WavAudioFormat>();
+    }
+
+    /** Renders one job to its file. Returns an error message, or an empty string. */
+    juce::String renderToFile (const RenderJob& job, const juce::File& file)
+    {
+        if (job.samples.isNotEmpty() && ! job.sampleFolder.isDirectory())
+            return "can't find the samples in " + job.sampleFolder.getFullPathName();
+
+        if (job.impulseResponse.isNotEmpty() && ! job.impulseResponseFile.existsAsFile())
+            return "can't find the impulse response " + job.impulseResponseFile.getFullPathName();
+
+        auto format = createFormatFor (file);
+
+        if (! format->getPossibleBitDepths().contains (job.bitDepth))
+            return format->getFormatName() + " can't be written at " + juce::String (job.bitDepth) + " bits";
+
+        if (! file.getParentDirectory().createDirectory() || (file.existsAsFile() && ! file.deleteFile()))
+            return "can't write to " + file.getFullPathName();
+
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            return "can't open " + file.getFullPathName();
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), job.sampleRate,
+                                                                                  (unsigned int) SynthEngine::numOutputChannels,
+                                                                                  job.bitDepth, {}, 0));
+        if (writer == nullptr)
+            return "can't create a " + format->getFormatName() + " writer";
+
+        stream.release();   // the writer owns it now
+
+        auto rendered = job.render ([&writer] (const float* const* channels, int numSamples)
+        {
+            return writer->writeFromFloatArrays (channels, SynthEngine::numOutputChannels, numSamples);
+        });
+
+        return rendered ? juce::String() : "writing " + file.getFullPathName() + " failed";
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args.containsOption ("--help|-h"))
+    {
+        log ("Usage: " + args.executableName + " <script.json> [--threads N] [--output-dir <folder>]"
+               " [--oversampling 1|2|4|8]");
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    // Missing files and bad options throw, and are reported here
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        auto scriptFile = args[0].resolveAsExistingFile();
+        juce::var script;
+        auto result = juce::JSON::parse (scriptFile.loadFileAsString(), script);
+
+        std::vector<RenderJob> jobs;
+
+        if (result.wasOk())
+            result = RenderScript::parse (script, jobs);
+
+        if (result.failed())
+            juce::ConsoleApplication::fail (scriptFile.getFileName() + ": " + result.getErrorMessage());
+
+        if (args.containsOption ("--oversampling"))
+        {
+            const auto factor = args.getValueForOption ("--oversampling").getIntValue();
+
+            if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+                juce::ConsoleApplication::fail ("--oversampling must be 1, 2, 4 or 8");
+
+            for (auto& job : jobs)
+                job.oversampling = factor;
+        }
+
+        // Sample folders and impulse responses are relative to the script, wherever the output goes
+        for (auto& job : jobs)
+        {
+            if (job.samples.isNotEmpty())
+                job.sampleFolder = scriptFile.getParentDirectory().getChildFile (job.samples);
+
+            if (job.impulseResponse.isNotEmpty())
+                job.impulseResponseFile = scriptFile.getParentDirectory().getChildFile (job.impulseResponse);
+        }
+
+        auto outputDirectory = args.containsOption ("--output-dir") ? args.getFileForOption ("--output-dir")
+                                                                     : scriptFile.getParentDirectory();
+        auto numThreads = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                            : juce::SystemStats::getNumCpus();
+        numThreads = juce::jlimit (1, juce::jmax (1, (int) jobs.size()), numThreads);
+
+        juce::ThreadPool pool (juce::ThreadPoolOptions{}.withThreadName ("SynthRender")
+                                                        .withNumberOfThreads (numThreads));
+
+        std::atomic<int> numRemaining { (int) jobs.size() }, numFailed { 0 };
+        juce::WaitableEvent finished;
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        for (auto& job : jobs)
+        {
+            pool.addJob ([&, file = outputDirectory.getChildFile (job.output)]
+            {
+                const auto jobStart = juce::Time::getMillisecondCounterHiRes();
+                auto error = renderToFile (job, file);
+                const auto seconds = (juce::Time::getMillisecondCounterHiRes() - jobStart) * 0.001;
+                const auto audioSeconds = (double) job.lengthInSamples / job.sampleRate;
+
+                if (error.isEmpty())
+                {
+                    log (job.name + ": " + juce::String (audioSeconds, 2) + " s of audio in " + juce::String (seconds, 3)
+                           + " s (" + juce::String (audioSeconds / juce::jmax (seconds, 1.0e-6), 1) + "x realtime)");
+                }
+                else
+                {
+                    log (job.name + ": " + error);
+                    ++numFailed;
+                }
+
+                if (--numRemaining == 0)
+                    finished.signal();
+            });
+        }
+
+        if (! jobs.empty())
+            finished.wait();
+
+        log ("Rendered " + juce::String ((int) jobs.size() - numFailed.load()) + " of " + juce::String ((int) jobs.size())
+               + " jobs on " + juce::String (numThreads) + " threads in "
+               + juce::String ((juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001, 2) + " s");
+
+        return numFailed > 0 ? 1 : 0;
+    });
+}
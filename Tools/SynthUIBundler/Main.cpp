@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+
+    Minifies the web UI and packs it, with the images it uses, into one zip
+    file that the build embeds in the app as binary data.
+
+    Usage: SynthUIBundler --output <bundle.zip> --ui <UI folder>
+                          [--assets <Assets folder>] [--atlases <Atlases folder>]
+
+    The zip holds the top-level files of each folder, under the path the web
+    UI requests them by: UI files at the root, the rest under "Assets/" and
+    "Atlases/". HTML, CSS and JS are minified and deflated. Images are stored
+    as they are, because PNGs are already compressed, which also means the app
+    can serve them without inflating anything.
+
+  ==============================================================================
+*/
+
+#include <juce_core/juce_core.h>
+
+namespace
+{
+    /** Copies a quoted string starting at i verbatim, and returns the index after it. */
+    int copyQuoted (const juce::String& text, int i, juce::String& out)
+    {
+        const auto quote = text[i];
+        auto end = i + 1;
+
+        while (end < text.length() && text[end] != quote)
+            end += text[end] == '\\' ? 2 : 1;
+
+        end = juce::jmin (end + 1, text.length());
+        out += text.substring (i, end);
+        return end;
+    }
+
+    /** Removes comments and collapses whitespace, leaving quoted strings alone. */
+    juce::String minifyCSS (const juce::String& css)
+    {
+        juce::String out;
+        out.preallocateBytes (css.getNumBytesAsUTF8());
+
+        // Characters that never need a space either side. Not ':', because "a :hover"
+        // and "a:hover" are different selectors
+        const juce::String tight ("{};,>");
+        bool pendingSpace = false;
+
+        for (int i = 0; i < css.length();)
+        {
+            const auto c = css[i];
+
+            if (c == '/' && css[i + 1] == '*')
+            {
+                auto end = css.indexOf (i + 2, "*/");
+                i = end < 0 ? css.length() : end + 2;
+                continue;
+            }
+
+            if (juce::CharacterFunctions::isWhitespace (c))
+            {
+                pendingSpace = true;
+                ++i;
+                continue;
+            }
+
+            if (pendingSpace && out.isNotEmpty()
+                 && ! tight.containsChar (c) && ! tight.containsChar (out.getLastCharacter()))
+                out << ' ';
+
+            pendingSpace = false;
+
+            if (c == '"' || c == '\'')
+            {
+                i = copyQuoted (css, i, out);
+            }
+            else
+            {
+                out << juce::String::charToString (c);
+                ++i;
+            }
+        }
+
+        return out;
+    }
+
+    bool isWholeLineComment (const juce::String& line, bool javaScript)
+    {
+        return javaScript ? line.startsWith ("//")
+                          : line.startsWith ("<!--") && line.endsWith ("-->");
+    }
+
+    /** Trims every line and drops blank lines and whole-line comments.
+
+        This deliberately goes no further. The line breaks stay, so automatic semicolon
+        insertion in the JS is unaffected, and lines inside template literals that span
+        several lines are kept exactly as they are.
+    */
+    juce::String minifyLines (const juce::String& text, bool javaScript)
+    {
+        juce::StringArray lines;
+        lines.addLines (text);
+
+        juce::String out;
+        out.preallocateBytes (text.getNumBytesAsUTF8());
+
+        bool inTemplate = false;
+
+        for (auto& line : lines)
+        {
+            auto trimmed = line.trim();
+
+            if (inTemplate)
+                out << line << '\n';
+            else if (trimmed.isNotEmpty() && ! isWholeLineComment (trimmed, javaScript))
+                out << trimmed << '\n';
+
+            // An odd number of backticks opens or closes a template literal
+            if ((line.length() - line.removeCharacters ("`").length()) % 2 == 1)
+                inTemplate = ! inTemplate;
+        }
+
+        return out;
+    }
+
+    juce::String minify (const juce::File& file)
+    {
+        const auto text = file.loadFileAsString();
+
+        if (file.hasFileExtension ("css"))
+            return minifyCSS (text);
+
+        return minifyLines (text, file.hasFileExtension ("js"));
+    }
+
+    bool isText (const juce::File& file)
+    {
+        return file.hasFileExtension ("html;css;js;json");
+    }
+
+    /** Adds a folder's top-level files to the bundle. Returns the number of bytes before and after minifying. */
+    std::pair<juce::int64, juce::int64> addFolder (juce::ZipFile::Builder& builder, const juce::File& folder,
+                                                   const juce::String& prefix, const juce::String& wildcard)
+    {
+        juce::int64 originalBytes = 0, bundledBytes = 0;
+
+        auto files = folder.findChildFiles (juce::File::findFiles, false, wildcard);
+        files.sort();
+
+        for (auto& file : files)
+        {
+            const auto path = prefix + file.getFileName();
+            originalBytes += file.getSize();
+
+            if (file.hasFileExtension ("html;css;js"))
+            {
+                auto minified = minify (file);
+                bundledBytes += (juce::int64) minified.getNumBytesAsUTF8();
+                builder.addEntry (new juce::MemoryInputStream (minified.toRawUTF8(), minified.getNumBytesAsUTF8(), true),
+                                  9, path, file.getLastModificationTime());
+            }
+            else
+            {
+                bundledBytes += file.getSize();
+                builder.addFile (file, isText (file) ? 9 : 0, path);
+            }
+        }
+
+        return { originalBytes, bundledBytes };
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args.containsOption ("--help|-h"))
+    {
+        std::cout << "Usage: " << args.executableName
+                  << " --output <bundle.zip> --ui <UI folder> [--assets <Assets folder>] [--atlases <Atlases folder>]"
+                  << std::endl;
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        auto outputFile = args.getFileForOption ("--output");
+        juce::ZipFile::Builder builder;
+
+        auto total = addFolder (builder, args.getExistingFolderForOption ("--ui"), {}, "*.html;*.css;*.js");
+
+        for (auto [option, prefix] : { std::pair { "--assets", "Assets/" }, std::pair { "--atlases", "Atlases/" } })
+        {
+            if (args.containsOption (option))
+            {
+                auto bytes = addFolder (builder, args.getExistingFolderForOption (option), prefix, "*");
+                total.first += bytes.first;
+                total.second += bytes.second;
+            }
+        }
+
+        if (! outputFile.getParentDirectory().createDirectory() || (outputFile.existsAsFile() && ! outputFile.deleteFile()))
+            juce::ConsoleApplication::fail ("Can't write " + outputFile.getFullPathName());
+
+        juce::FileOutputStream stream (outputFile);
+
+        if (stream.failedToOpen() || ! builder.writeToStream (stream, nullptr))
+            juce::ConsoleApplication::fail ("Couldn't write " + outputFile.getFullPathName());
+
+        stream.flush();
+
+        std::cout << "UI bundle: " << (total.first / 1024) << " KB of files, " << (total.second / 1024)
+                  << " KB after minifying, " << (stream.getPosition() / 1024) << " KB compressed" << std::endl;
+        return 0;
+    });
+}
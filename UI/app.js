@@ -3,27 +3,107 @@
 // ============================================
 
 // JUCE 8 WebView message passing helper
-function sendToJUCE(message) {
+function emitToJUCE(eventName, payload) {
     // JUCE 8 uses window.__JUCE__.backend.emitEvent() for message passing
     if (typeof window.__JUCE__ !== 'undefined' && 
         typeof window.__JUCE__.backend !== 'undefined' &&
         typeof window.__JUCE__.backend.emitEvent === 'function') {
         // Send message using JUCE 8 native integration
-        window.__JUCE__.backend.emitEvent('message', message);
+        window.__JUCE__.backend.emitEvent(eventName, payload);
     } else {
         // Fallback for different platforms
         if (window.chrome && window.chrome.webview) {
             // Windows WebView2
-            window.chrome.webview.postMessage(message);
+            window.chrome.webview.postMessage(payload);
         } else if (window.webkit && window.webkit.messageHandlers) {
             // macOS WKWebView (alternative method)
-            window.webkit.messageHandlers.juce.postMessage(message);
+            window.webkit.messageHandlers.juce.postMessage(payload);
         } else {
             console.warn('JUCE message handler not available');
         }
     }
 }
 
+function sendToJUCE(message) {
+    // Anything still pending goes first, so a note plays with the latest settings
+    flushControls();
+    emitToJUCE('message', message);
+}
+
+// ============================================
+// Control changes
+// ============================================
+
+// Numeric control IDs. These must match UIControl in Source/UIProtocol.h
+const ControlID = Object.freeze({
+    volume: 0,
+    frequency: 1,
+    detune: 2,
+    unison: 3,
+    spread: 4,
+    attack: 5,
+    decay: 6,
+    sustain: 7,
+    release: 8,
+    cutoff: 9,
+    resonance: 10,
+    waveform: 11,
+    filterType: 12,
+    oversampling: 13,
+    oscillator: 14,
+    lfo1Rate: 15,
+    lfo2Rate: 16,
+    chorusMix: 17,
+    chorusRate: 18,
+    chorusDepth: 19,
+    delayMix: 20,
+    delayTime: 21,
+    delayFeedback: 22,
+    tempo: 23,
+    reverbMix: 24
+});
+
+// Changes are coalesced, so dragging a slider sends at most one update per
+// animation frame with the latest value of every control that moved. The batch
+// goes as one 'params' event: a base64-encoded Float32Array of [id, value, ...]
+const pendingControls = new Map();
+let controlFlushPending = false;
+
+// Set while the controls are being moved to match a preset the engine already has
+let applyingPreset = false;
+
+function setControl(id, value) {
+    if (applyingPreset) return;
+
+    pendingControls.set(id, value);
+
+    if (!controlFlushPending) {
+        controlFlushPending = true;
+        requestAnimationFrame(flushControls);
+    }
+}
+
+function flushControls() {
+    controlFlushPending = false;
+    if (pendingControls.size === 0) return;
+
+    const batch = new Float32Array(pendingControls.size * 2);
+    let i = 0;
+    pendingControls.forEach((value, id) => {
+        batch[i++] = id;
+        batch[i++] = value;
+    });
+    pendingControls.clear();
+
+    // Float32Array uses the platform's byte order, which is little-endian everywhere JUCE runs
+    const bytes = new Uint8Array(batch.buffer);
+    let binary = '';
+    for (let j = 0; j < bytes.length; j++) {
+        binary += String.fromCharCode(bytes[j]);
+    }
+    emitToJUCE('params', btoa(binary));
+}
+
 // Update value displays with smooth animations
 function updateValueDisplay(elementId, value, suffix = '') {
     const element = document.getElementById(elementId);
@@ -44,7 +124,7 @@ document.addEventListener('DOMContentLoaded', function() {
     volumeSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('volumeValue', value, '%');
-        sendToJUCE({type: 'volume', value: value});
+        setControl(ControlID.volume, value);
     });
 
     // Frequency Control
@@ -52,7 +132,7 @@ document.addEventListener('DOMContentLoaded', function() {
     frequencySlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('frequencyValue', value, ' Hz');
-        sendToJUCE({type: 'frequency', value: value});
+        setControl(ControlID.frequency, value);
     });
 
     // Detune Control
@@ -60,7 +140,23 @@ document.addEventListener('DOMContentLoaded', function() {
     detuneSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('detuneValue', value, ' cents');
-        sendToJUCE({type: 'detune', value: value});
+        setControl(ControlID.detune, value);
+    });
+
+    // Unison Control
+    const unisonSlider = document.getElementById('unison');
+    unisonSlider.addEventListener('input', function(e) {
+        const value = parseInt(e.target.value);
+        updateValueDisplay('unisonValue', value, value === 1 ? ' voice' : ' voices');
+        setControl(ControlID.unison, value);
+    });
+
+    // Spread Control
+    const spreadSlider = document.getElementById('spread');
+    spreadSlider.addEventListener('input', function(e) {
+        const value = parseFloat(e.target.value);
+        updateValueDisplay('spreadValue', value, '%');
+        setControl(ControlID.spread, value);
     });
 
     // Attack Control
@@ -68,7 +164,7 @@ document.addEventListener('DOMContentLoaded', function() {
     attackSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('attackValue', value, ' ms');
-        sendToJUCE({type: 'attack', value: value});
+        setControl(ControlID.attack, value);
     });
 
     // Decay Control
@@ -76,7 +172,7 @@ document.addEventListener('DOMContentLoaded', function() {
     decaySlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('decayValue', value, ' ms');
-        sendToJUCE({type: 'decay', value: value});
+        setControl(ControlID.decay, value);
     });
 
     // Sustain Control
@@ -84,7 +180,7 @@ document.addEventListener('DOMContentLoaded', function() {
     sustainSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('sustainValue', value, '%');
-        sendToJUCE({type: 'sustain', value: value});
+        setControl(ControlID.sustain, value);
     });
 
     // Release Control
@@ -92,7 +188,7 @@ document.addEventListener('DOMContentLoaded', function() {
     releaseSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('releaseValue', value, ' ms');
-        sendToJUCE({type: 'release', value: value});
+        setControl(ControlID.release, value);
     });
 
     // Cutoff Control
@@ -100,7 +196,7 @@ document.addEventListener('DOMContentLoaded', function() {
     cutoffSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('cutoffValue', value, ' Hz');
-        sendToJUCE({type: 'cutoff', value: value});
+        setControl(ControlID.cutoff, value);
     });
 
     // Resonance Control
@@ -108,21 +204,101 @@ document.addEventListener('DOMContentLoaded', function() {
     resonanceSlider.addEventListener('input', function(e) {
         const value = parseFloat(e.target.value);
         updateValueDisplay('resonanceValue', value);
-        sendToJUCE({type: 'resonance', value: value});
+        setControl(ControlID.resonance, value);
     });
 
     // Waveform Select
     const waveformSelect = document.getElementById('waveform');
+    // The options are in the same order as the Waveform and FilterType enums
     waveformSelect.addEventListener('change', function(e) {
-        sendToJUCE({type: 'waveform', value: e.target.value});
+        setControl(ControlID.waveform, e.target.selectedIndex);
     });
 
     // Filter Type Select
     const filterTypeSelect = document.getElementById('filterType');
     filterTypeSelect.addEventListener('change', function(e) {
-        sendToJUCE({type: 'filterType', value: e.target.value});
+        setControl(ControlID.filterType, e.target.selectedIndex);
     });
 
+    // Oversampling Select: the index is the power of two, 1x to 8x
+    const oversamplingSelect = document.getElementById('oversampling');
+    oversamplingSelect.addEventListener('change', function(e) {
+        setControl(ControlID.oversampling, e.target.selectedIndex);
+    });
+
+    // Oscillator Source Select: wavetable or samples, in OscillatorType order
+    const oscillatorSelect = document.getElementById('oscillator');
+    oscillatorSelect.addEventListener('change', function(e) {
+        setControl(ControlID.oscillator, e.target.selectedIndex);
+    });
+
+    // LFO Rate Controls
+    ['lfo1Rate', 'lfo2Rate'].forEach(function(id) {
+        document.getElementById(id).addEventListener('input', function(e) {
+            const value = parseFloat(e.target.value);
+            updateValueDisplay(id + 'Value', value, ' Hz');
+            setControl(ControlID[id], value);
+        });
+    });
+
+    // Modulation Routes: the whole matrix is sent on every edit, and compiled by JUCE
+    const modRoutes = document.getElementById('modRoutes');
+    const modRouteTemplate = document.getElementById('modRouteTemplate');
+
+    for (let i = 0; i < MOD_ROUTE_COUNT; i++) {
+        modRoutes.appendChild(modRouteTemplate.content.cloneNode(true));
+    }
+
+    modRoutes.addEventListener('change', sendModulationRoutes);
+
+    // Effect Controls
+    const effectControls = {
+        chorusMix: '%', chorusRate: ' Hz', chorusDepth: '%',
+        delayMix: '%', delayTime: ' beats', delayFeedback: '%',
+        tempo: ' BPM', reverbMix: '%'
+    };
+
+    Object.keys(effectControls).forEach(function(id) {
+        document.getElementById(id).addEventListener('input', function(e) {
+            const value = parseFloat(e.target.value);
+            updateValueDisplay(id + 'Value', value, effectControls[id]);
+            setControl(ControlID[id], value);
+        });
+    });
+
+    // Reverb: JUCE asks for an impulse response file and loads it in the background
+    document.getElementById('impulseResponseLoadButton').addEventListener('click', function() {
+        sendToJUCE({type: 'loadImpulseResponse'});
+    });
+
+    // Samples: JUCE asks for a folder, then maps it in the background
+    document.getElementById('sampleLoadButton').addEventListener('click', function() {
+        sendToJUCE({type: 'loadSamples'});
+    });
+
+    // Presets: the engine loads them in the background and tells us when it has
+    const presetSelect = document.getElementById('presetSelect');
+    presetSelect.addEventListener('change', function(e) {
+        if (e.target.value) {
+            sendToJUCE({type: 'loadPreset', name: e.target.value});
+        }
+    });
+
+    const presetName = document.getElementById('presetName');
+    const savePreset = function() {
+        const name = presetName.value.trim();
+        if (name) {
+            sendToJUCE({type: 'savePreset', name: name});
+        }
+    };
+
+    document.getElementById('presetSaveButton').addEventListener('click', savePreset);
+    presetName.addEventListener('keydown', function(e) {
+        if (e.key === 'Enter') savePreset();
+    });
+
+    sendToJUCE({type: 'listPresets'});
+
     // Play Button
     const playButton = document.getElementById('playButton');
     playButton.addEventListener('click', function() {
@@ -174,6 +350,203 @@ function stopNote() {
     }
 }
 
+// Show the audio thread's health counters in the diagnostics panel
+function updateTelemetryPanel(t) {
+    const setText = (id, text) => {
+        const element = document.getElementById(id);
+        if (element) element.textContent = text;
+    };
+    const percent = (x) => (x * 100).toFixed(1) + '%';
+    const micros = (x) => x.toFixed(0) + ' µs';
+
+    setText('telemetryLoad', percent(t.lastLoad));
+    setText('telemetryLoadDetail', 'avg ' + percent(t.averageLoad) + ' / peak ' + percent(t.peakLoad));
+    setText('telemetryBlock', micros(t.lastBlockMicroseconds));
+    setText('telemetryBlockDetail', 'budget ' + micros(t.budgetMicroseconds) + ' / peak ' + micros(t.peakBlockMicroseconds)
+                                    + ' (' + t.blockSize + ' @ ' + t.sampleRate + ' Hz)');
+
+    const xruns = t.deviceXRuns >= 0 ? t.deviceXRuns : 0;
+    setText('telemetryDropouts', t.overruns + t.lateCallbacks + xruns);
+    setText('telemetryDropoutsDetail', 'overruns ' + t.overruns + ' / late ' + t.lateCallbacks
+                                       + ' / xruns ' + (t.deviceXRuns >= 0 ? t.deviceXRuns : 'n/a'));
+    setText('telemetryVoices', t.activeVoices);
+    setText('telemetryVoicesDetail', 'peak ' + t.peakVoices + ' / steals ' + t.voiceSteals);
+
+    const histogram = document.getElementById('telemetryHistogram');
+    if (!histogram || !t.loadHistogram) return;
+
+    if (histogram.children.length !== t.loadHistogram.length) {
+        histogram.innerHTML = '';
+        t.loadHistogram.forEach((_, i) => {
+            const bar = document.createElement('div');
+            const from = i * t.loadBucketWidth;
+            bar.className = 'bar' + (from >= 1 ? ' over-budget' : '');
+            bar.title = Math.round(from * 100) + '-' + Math.round((from + t.loadBucketWidth) * 100) + '%';
+            histogram.appendChild(bar);
+        });
+    }
+
+    // Log scale, so rare slow blocks are still visible next to the common fast ones
+    const maxCount = Math.max(1, ...t.loadHistogram);
+    t.loadHistogram.forEach((count, i) => {
+        const bar = histogram.children[i];
+        bar.style.height = (count > 0 ? Math.log1p(count) / Math.log1p(maxCount) * 100 : 0) + '%';
+        bar.title = bar.title.split(':')[0] + ': ' + count + ' blocks';
+    });
+}
+
+// Output meters, scope and spectrum, fed by VisualisationFeed in C++. Each frame is
+// a base64 Float32Array of [peakL, peakR, rmsL, rmsR, scope * 256, spectrum * 64 (dB)]
+const Visualisation = Object.freeze({
+    meterValues: 4,
+    scopePoints: 256,
+    spectrumBands: 64,
+    vuReferenceDb: -18,         // the level that reads 0 VU
+    vuMinDb: -20,               // the needle's range, in VU
+    vuMaxDb: 3,
+    vuTimeMs: 300,              // integration time of a classic VU meter
+    ledMinDb: -60,
+    ledFallDbPerSecond: 24,
+    spectrumMinDb: -90
+});
+
+const visualisationState = {
+    latest: null,               // the newest frame, waiting to be drawn
+    drawPending: false,
+    lastDrawTime: 0,
+    vu: [Visualisation.vuMinDb, Visualisation.vuMinDb],
+    led: [Visualisation.ledMinDb, Visualisation.ledMinDb],
+    meters: null
+};
+
+function createOutputMeters() {
+    if (typeof UIComponents === 'undefined') return null;
+
+    const components = new UIComponents();
+    const meters = {
+        vu: [
+            components.createMeter('vuMeterLeft', { atlas: 'meter_vu', width: 160, height: 92, label: 'L' }),
+            components.createMeter('vuMeterRight', { atlas: 'meter_vu', width: 160, height: 92, label: 'R' })
+        ],
+        led: [
+            components.createMeter('ledMeterLeft', { atlas: 'meter_led', width: 16, height: 140 }),
+            components.createMeter('ledMeterRight', { atlas: 'meter_led', width: 16, height: 140 })
+        ]
+    };
+    return meters.vu.every(m => m) && meters.led.every(m => m) ? meters : null;
+}
+
+function receiveVisualisation(base64) {
+    const bytes = Uint8Array.from(atob(base64), c => c.charCodeAt(0));
+    visualisationState.latest = new Float32Array(bytes.buffer);
+
+    // Frames can arrive faster than the page repaints; only the newest gets drawn
+    if (!visualisationState.drawPending) {
+        visualisationState.drawPending = true;
+        requestAnimationFrame(drawVisualisation);
+    }
+}
+
+function drawVisualisation(now) {
+    visualisationState.drawPending = false;
+
+    const frame = visualisationState.latest;
+    if (!frame || frame.length < Visualisation.meterValues + Visualisation.scopePoints + Visualisation.spectrumBands) return;
+
+    const elapsed = visualisationState.lastDrawTime > 0 ? Math.min(0.25, (now - visualisationState.lastDrawTime) / 1000) : 0;
+    visualisationState.lastDrawTime = now;
+
+    drawMeters(frame, elapsed);
+    drawScope(frame.subarray(Visualisation.meterValues, Visualisation.meterValues + Visualisation.scopePoints));
+    drawSpectrum(frame.subarray(Visualisation.meterValues + Visualisation.scopePoints));
+}
+
+function drawMeters(frame, elapsed) {
+    const toDb = (gain) => gain > 0 ? 20 * Math.log10(gain) : -200;
+    const meters = visualisationState.meters;
+
+    // The VU needle follows the RMS level with its usual sluggishness; the LED
+    // ladder jumps to each peak and falls back slowly
+    const vuCoefficient = 1 - Math.exp(-elapsed * 1000 / Visualisation.vuTimeMs);
+
+    for (let channel = 0; channel < 2; ++channel) {
+        const vuTarget = Math.max(Visualisation.vuMinDb, toDb(frame[2 + channel]) - Visualisation.vuReferenceDb);
+        visualisationState.vu[channel] += (vuTarget - visualisationState.vu[channel]) * vuCoefficient;
+
+        const peak = Math.max(Visualisation.ledMinDb, toDb(frame[channel]));
+        const fallen = visualisationState.led[channel] - Visualisation.ledFallDbPerSecond * elapsed;
+        visualisationState.led[channel] = Math.max(peak, fallen, Visualisation.ledMinDb);
+
+        if (meters) {
+            meters.vu[channel].setLevel((visualisationState.vu[channel] - Visualisation.vuMinDb)
+                                        / (Visualisation.vuMaxDb - Visualisation.vuMinDb));
+            meters.led[channel].setLevel((visualisationState.led[channel] - Visualisation.ledMinDb)
+                                         / -Visualisation.ledMinDb);
+        }
+    }
+}
+
+function prepareCanvas(id) {
+    const canvas = document.getElementById(id);
+    if (!canvas) return null;
+
+    // Match the backing store to the displayed size, so lines stay sharp
+    const scale = window.devicePixelRatio || 1;
+    const width = Math.round(canvas.clientWidth * scale);
+    const height = Math.round(canvas.clientHeight * scale);
+    if (canvas.width !== width || canvas.height !== height) {
+        canvas.width = width;
+        canvas.height = height;
+    }
+
+    const context = canvas.getContext('2d');
+    context.clearRect(0, 0, width, height);
+    return { context, width, height };
+}
+
+function drawScope(points) {
+    const target = prepareCanvas('scopeCanvas');
+    if (!target) return;
+    const { context, width, height } = target;
+
+    context.strokeStyle = 'rgba(255, 255, 255, 0.15)';
+    context.beginPath();
+    context.moveTo(0, height / 2);
+    context.lineTo(width, height / 2);
+    context.stroke();
+
+    context.strokeStyle = '#00d4ff';
+    context.lineWidth = 1.5 * (window.devicePixelRatio || 1);
+    context.beginPath();
+    for (let i = 0; i < points.length; ++i) {
+        const x = i / (points.length - 1) * width;
+        const y = (1 - Math.max(-1, Math.min(1, points[i]))) * height / 2;
+        if (i === 0) context.moveTo(x, y);
+        else context.lineTo(x, y);
+    }
+    context.stroke();
+}
+
+function drawSpectrum(bands) {
+    const target = prepareCanvas('spectrumCanvas');
+    if (!target) return;
+    const { context, width, height } = target;
+
+    const barWidth = width / bands.length;
+    context.fillStyle = '#00d4ff';
+    for (let i = 0; i < bands.length; ++i) {
+        const level = Math.max(0, Math.min(1, 1 - bands[i] / Visualisation.spectrumMinDb));
+        const barHeight = level * height;
+        context.fillRect(i * barWidth + 1, height - barHeight, Math.max(1, barWidth - 2), barHeight);
+    }
+}
+
+window.receiveVisualisation = receiveVisualisation;
+
+document.addEventListener('DOMContentLoaded', function() {
+    visualisationState.meters = createOutputMeters();
+});
+
 // Listen for messages from JUCE C++
 function receiveMessageFromJUCE(message) {
     console.log('Message from JUCE:', message);
@@ -188,10 +561,102 @@ function receiveMessageFromJUCE(message) {
         const frequencySlider = document.getElementById('frequency');
         frequencySlider.value = message.value;
         updateValueDisplay('frequencyValue', message.value, ' Hz');
+    } else if (message.type === 'telemetry') {
+        updateTelemetryPanel(message);
+    } else if (message.type === 'presetList') {
+        updatePresetList(message.names);
+    } else if (message.type === 'presetLoaded') {
+        showLoadedPreset(message.name, message.controls);
+    } else if (message.type === 'samplesLoaded') {
+        showSampleLibrary(message.name, message.error);
+    } else if (message.type === 'impulseResponseLoaded') {
+        const impulseResponse = document.getElementById('impulseResponse');
+        impulseResponse.value = message.name;
+        impulseResponse.title = message.name;
     }
     // Add more update handlers as needed
 }
 
+// ============================================
+// Presets
+// ============================================
+
+function updatePresetList(names) {
+    const presetSelect = document.getElementById('presetSelect');
+    const selected = presetSelect.value;
+
+    // Keep the placeholder, replace the rest
+    while (presetSelect.options.length > 1) {
+        presetSelect.remove(1);
+    }
+
+    (names || []).forEach(function(name) {
+        presetSelect.add(new Option(name, name, false, name === selected));
+    });
+}
+
+// Moves every control to a preset the engine has switched to. The controls' own
+// handlers update the value displays, but don't send anything back
+function showLoadedPreset(name, controls) {
+    applyingPreset = true;
+
+    Object.keys(controls || {}).forEach(function(control) {
+        const element = document.getElementById(control);
+        if (!element) return;
+
+        if (element.tagName === 'SELECT') {
+            element.selectedIndex = controls[control];
+            element.dispatchEvent(new Event('change'));
+        } else {
+            element.value = controls[control];
+            element.dispatchEvent(new Event('input'));
+        }
+    });
+
+    applyingPreset = false;
+
+    document.getElementById('presetSelect').value = name;
+    document.getElementById('presetName').value = name;
+}
+
+// ============================================
+// Modulation
+// ============================================
+
+const MOD_ROUTE_COUNT = 4;
+
+function sendModulationRoutes() {
+    const routes = [];
+
+    document.querySelectorAll('#modRoutes .mod-route').forEach(function(row) {
+        const source = row.querySelector('.mod-source').value;
+        if (!source) return;
+
+        routes.push({
+            source: source,
+            destination: row.querySelector('.mod-destination').value,
+            amount: parseFloat(row.querySelector('.mod-amount').value) / 100,
+            rate: row.querySelector('.mod-rate').value
+        });
+    });
+
+    sendToJUCE({type: 'modulation', routes: routes});
+}
+
+// ============================================
+// Samples
+// ============================================
+
+function showSampleLibrary(name, error) {
+    const sampleLibrary = document.getElementById('sampleLibrary');
+    sampleLibrary.value = error ? '' : name;
+    sampleLibrary.title = error || name;
+
+    if (error) {
+        console.error('Couldn\'t load samples: ' + error);
+    }
+}
+
 // Make function globally available for JUCE to call
 window.receiveMessageFromJUCE = receiveMessageFromJUCE;
 
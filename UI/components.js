@@ -20,6 +20,45 @@ class UIComponents {
         return frameIndex;
     }
 
+    // ============================================
+    // Sprite Atlases - every frame of a control in one image, packed at build
+    // time by SynthAtlasPacker and described by Atlases/atlases.json
+    // ============================================
+    loadAtlasIndex() {
+        if (!this.atlasIndex) {
+            this.atlasIndex = fetch('Atlases/atlases.json')
+                .then(response => response.json())
+                .then(index => index.atlases)
+                .catch(error => {
+                    console.error('Failed to load the atlas index', error);
+                    return {};
+                });
+        }
+        return this.atlasIndex;
+    }
+
+    // Sizes an element to show an atlas's frames as large as fit in the given box,
+    // and returns the frame size on screen
+    attachAtlas(element, atlas, boxWidth, boxHeight) {
+        const scale = Math.min(boxWidth / atlas.frameWidth, boxHeight / atlas.frameHeight);
+        const width = atlas.frameWidth * scale;
+        const height = atlas.frameHeight * scale;
+
+        element.style.width = `${width}px`;
+        element.style.height = `${height}px`;
+        element.style.margin = 'auto';
+        element.style.backgroundImage = `url('Atlases/${atlas.image}')`;
+        element.style.backgroundSize = `${atlas.columns * width}px ${atlas.rows * height}px`;
+        return { width, height };
+    }
+
+    // Shows one frame of an atlas attached with attachAtlas()
+    showAtlasFrame(element, atlas, frameSize, frameIndex) {
+        const column = frameIndex % atlas.columns;
+        const row = Math.floor(frameIndex / atlas.columns);
+        element.style.backgroundPosition = `${-column * frameSize.width}px ${-row * frameSize.height}px`;
+    }
+
     // ============================================
     // Knob Component with Filmstrip
     // ============================================
@@ -29,7 +68,7 @@ class UIComponents {
             min = 0,
             max = 100,
             value = 50,
-            filmstrip = 'knob_small_black_128_frames.png',
+            atlas = 'knob_small_black',
             size = 80,
             label = '',
             onChange = null
@@ -48,6 +87,7 @@ class UIComponents {
             width: ${size}px;
             height: ${size}px;
             position: relative;
+            display: flex;
             margin: 0 auto;
             cursor: pointer;
             user-select: none;
@@ -58,8 +98,6 @@ class UIComponents {
         knobImage.style.cssText = `
             width: 100%;
             height: 100%;
-            background-image: url('Assets/PNG Filmstripes 128 frames/${filmstrip}');
-            background-size: ${size * 128}px ${size}px;
             background-repeat: no-repeat;
             background-position: 0 0;
             image-rendering: pixelated;
@@ -92,18 +130,34 @@ class UIComponents {
         let isDragging = false;
         let startY = 0;
         let startValue = 0;
+        let atlasInfo = null;
+        let frameSize = null;
+
+        const drawKnob = () => {
+            if (!atlasInfo) return;
+            const frameIndex = this.calculateFilmstripFrame(currentValue, min, max, atlasInfo.frames);
+            this.showAtlasFrame(knobImage, atlasInfo, frameSize, frameIndex);
+        };
 
         const updateKnob = (newValue) => {
             currentValue = Math.max(min, Math.min(max, newValue));
-            const frameIndex = this.calculateFilmstripFrame(currentValue, min, max, 128);
-            const offsetX = -frameIndex * size;
-            knobImage.style.backgroundPosition = `${offsetX}px 0`;
+            drawKnob();
             
             if (onChange) {
                 onChange(currentValue);
             }
         };
 
+        this.loadAtlasIndex().then(atlases => {
+            atlasInfo = atlases[atlas];
+            if (!atlasInfo) {
+                console.error(`Atlas ${atlas} not found`);
+                return;
+            }
+            frameSize = this.attachAtlas(knobImage, atlasInfo, size, size);
+            drawKnob();
+        });
+
         // Mouse events
         knobContainer.addEventListener('mousedown', (e) => {
             isDragging = true;
@@ -170,7 +224,7 @@ class UIComponents {
             min = 0,
             max = 100,
             value = 50,
-            filmstrip = 'slider_horizontal_128_frames.png',
+            atlas = 'slider_horizontal',
             orientation = 'horizontal', // 'horizontal' or 'vertical'
             width = 200,
             height = 30,
@@ -193,6 +247,7 @@ class UIComponents {
             width: ${isHorizontal ? width : height}px;
             height: ${isHorizontal ? height : width}px;
             position: relative;
+            display: flex;
             margin: 0 auto;
             cursor: pointer;
             user-select: none;
@@ -203,8 +258,6 @@ class UIComponents {
         sliderImage.style.cssText = `
             width: 100%;
             height: 100%;
-            background-image: url('Assets/PNG Filmstripes 128 frames/${filmstrip}');
-            background-size: ${isHorizontal ? `${height * 128}px ${height}px` : `${height}px ${height * 128}px`};
             background-repeat: no-repeat;
             background-position: 0 0;
             image-rendering: pixelated;
@@ -234,24 +287,36 @@ class UIComponents {
         let isDragging = false;
         let startPos = 0;
         let startValue = 0;
+        let atlasInfo = null;
+        let frameSize = null;
+
+        const drawSlider = () => {
+            if (!atlasInfo) return;
+            const frameIndex = this.calculateFilmstripFrame(currentValue, min, max, atlasInfo.frames);
+            this.showAtlasFrame(sliderImage, atlasInfo, frameSize, frameIndex);
+        };
 
         const updateSlider = (newValue) => {
             currentValue = Math.max(min, Math.min(max, newValue));
-            const frameIndex = this.calculateFilmstripFrame(currentValue, min, max, 128);
-            
-            if (isHorizontal) {
-                const offsetX = -frameIndex * height;
-                sliderImage.style.backgroundPosition = `${offsetX}px 0`;
-            } else {
-                const offsetY = -frameIndex * height;
-                sliderImage.style.backgroundPosition = `0 ${offsetY}px`;
-            }
+            drawSlider();
             
             if (onChange) {
                 onChange(currentValue);
             }
         };
 
+        this.loadAtlasIndex().then(atlases => {
+            atlasInfo = atlases[atlas];
+            if (!atlasInfo) {
+                console.error(`Atlas ${atlas} not found`);
+                return;
+            }
+            frameSize = this.attachAtlas(sliderImage, atlasInfo,
+                                         isHorizontal ? width : height,
+                                         isHorizontal ? height : width);
+            drawSlider();
+        });
+
         const getEventPos = (e) => {
             return isHorizontal ? e.clientX : e.clientY;
         };
@@ -482,6 +547,96 @@ class UIComponents {
         return component;
     }
 
+    // ============================================
+    // Meter Component with Filmstrip - display only, driven by setLevel()
+    // ============================================
+    createMeter(containerId, options = {}) {
+        const {
+            id = `meter_${Date.now()}`,
+            min = 0,
+            max = 1,
+            atlas = 'meter_vu',
+            width = 160,
+            height = 92,
+            label = ''
+        } = options;
+
+        const container = document.getElementById(containerId);
+        if (!container) {
+            console.error(`Container ${containerId} not found`);
+            return null;
+        }
+
+        const meterContainer = document.createElement('div');
+        meterContainer.className = 'meter-container';
+        meterContainer.id = id;
+        meterContainer.style.cssText = `
+            display: inline-block;
+            text-align: center;
+        `;
+
+        const meterImage = document.createElement('div');
+        meterImage.className = 'meter-image';
+        meterImage.style.cssText = `
+            width: ${width}px;
+            height: ${height}px;
+            background-repeat: no-repeat;
+            background-position: 0 0;
+        `;
+
+        const labelElement = label ? document.createElement('div') : null;
+        if (labelElement) {
+            labelElement.className = 'meter-label';
+            labelElement.textContent = label;
+            labelElement.style.cssText = `
+                margin-top: 5px;
+                font-size: 0.85em;
+                color: rgba(255, 255, 255, 0.8);
+            `;
+        }
+
+        meterContainer.appendChild(meterImage);
+        if (labelElement) meterContainer.appendChild(labelElement);
+        container.appendChild(meterContainer);
+
+        let currentLevel = min;
+        let currentFrame = -1;
+        let atlasInfo = null;
+        let frameSize = null;
+
+        // Levels arrive every frame, so only touch the style when the frame changes
+        const drawMeter = () => {
+            if (!atlasInfo) return;
+            const frameIndex = this.calculateFilmstripFrame(currentLevel, min, max, atlasInfo.frames);
+            if (frameIndex === currentFrame) return;
+            currentFrame = frameIndex;
+            this.showAtlasFrame(meterImage, atlasInfo, frameSize, frameIndex);
+        };
+
+        this.loadAtlasIndex().then(atlases => {
+            atlasInfo = atlases[atlas];
+            if (!atlasInfo) {
+                console.error(`Atlas ${atlas} not found`);
+                return;
+            }
+            frameSize = this.attachAtlas(meterImage, atlasInfo, width, height);
+            drawMeter();
+        });
+
+        const component = {
+            id,
+            setLevel: (level) => {
+                currentLevel = level;
+                drawMeter();
+            },
+            getLevel: () => currentLevel,
+            destroy: () => meterContainer.remove()
+        };
+
+        this.components.set(id, component);
+        return component;
+    }
+
     // ============================================
     // LED Component
     // ============================================